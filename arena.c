@@ -0,0 +1,157 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * arena.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+/* C */
+#include <string.h>
+
+/* glib */
+#include <glib.h>
+
+/* pkgclip */
+#include "arena.h"
+
+#define ARENA_BLOCK_SIZE    (256 * 1024)
+#define ARENA_ALIGN         (2 * sizeof (gpointer))
+#define ALIGN(size)         (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+struct _arena_block_t {
+    arena_block_t *next;
+    gsize          size;
+};
+
+/* data comes right after the header, aligned */
+#define BLOCK_DATA(block)   ((guint8 *) (block) + ALIGN (sizeof (arena_block_t)))
+
+arena_t *
+arena_new (void)
+{
+    arena_t *arena;
+
+    arena = g_new0 (arena_t, 1);
+    g_mutex_init (&arena->mutex);
+    arena->strings = g_string_chunk_new (ARENA_BLOCK_SIZE);
+    return arena;
+}
+
+/* returns size bytes of zeroed memory */
+gpointer
+arena_alloc (arena_t *arena, gsize size)
+{
+    arena_block_t *block;
+    guint8 *ptr;
+
+    size = ALIGN (size);
+
+    g_mutex_lock (&arena->mutex);
+    block = arena->blocks;
+    if (!block || arena->used + size > block->size)
+    {
+        gsize block_size = MAX (ARENA_BLOCK_SIZE, size);
+
+        block = g_malloc (ALIGN (sizeof (arena_block_t)) + block_size);
+        block->size = block_size;
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->used = 0;
+    }
+    ptr = BLOCK_DATA (block) + arena->used;
+    arena->used += size;
+    arena->size += size;
+    g_mutex_unlock (&arena->mutex);
+
+    memset (ptr, 0, size);
+    return ptr;
+}
+
+char *
+arena_strdup (arena_t *arena, const char *str)
+{
+    char *s;
+
+    g_mutex_lock (&arena->mutex);
+    s = g_string_chunk_insert (arena->strings, str);
+    arena->size += strlen (str) + 1;
+    g_mutex_unlock (&arena->mutex);
+    return s;
+}
+
+/* same as arena_strdup, only identical strings are stored once (e.g. package
+ * names, shared by all their versions). Must not be modified. */
+char *
+arena_intern (arena_t *arena, const char *str)
+{
+    char *s;
+
+    g_mutex_lock (&arena->mutex);
+    s = g_string_chunk_insert_const (arena->strings, str);
+    g_mutex_unlock (&arena->mutex);
+    return s;
+}
+
+/* size bytes (from arena_alloc/arena_strdup) are no longer used. Nothing is
+ * actually freed, this is only accounting */
+void
+arena_release (arena_t *arena, gsize size)
+{
+    g_mutex_lock (&arena->mutex);
+    arena->dead += size;
+    g_mutex_unlock (&arena->mutex);
+}
+
+gsize
+arena_get_size (arena_t *arena)
+{
+    gsize size;
+
+    g_mutex_lock (&arena->mutex);
+    size = arena->size;
+    g_mutex_unlock (&arena->mutex);
+    return size;
+}
+
+gsize
+arena_get_dead (arena_t *arena)
+{
+    gsize dead;
+
+    g_mutex_lock (&arena->mutex);
+    dead = arena->dead;
+    g_mutex_unlock (&arena->mutex);
+    return dead;
+}
+
+void
+arena_free (arena_t *arena)
+{
+    arena_block_t *block;
+
+    while ((block = arena->blocks))
+    {
+        arena->blocks = block->next;
+        g_free (block);
+    }
+    g_string_chunk_free (arena->strings);
+    g_mutex_clear (&arena->mutex);
+    g_free (arena);
+}
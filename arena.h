@@ -0,0 +1,56 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * arena.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef _PKGCLIP_ARENA_H
+#define _PKGCLIP_ARENA_H
+
+/* Memory for data that all goes away at once, e.g. everything from one scan:
+ * it is allocated from large blocks, never freed on its own, and released in
+ * one go with arena_free. What's no longer used can be accounted for with
+ * arena_release, so the caller can tell when it's time for a new arena. All
+ * functions are thread-safe.
+ */
+
+typedef struct _arena_block_t arena_block_t;
+
+typedef struct _arena_t {
+    GMutex         mutex;
+    /* current block first */
+    arena_block_t *blocks;
+    gsize          used;
+    GStringChunk  *strings;
+    /* bytes handed out (interned strings aside), and how many of those were
+     * released since */
+    gsize          size;
+    gsize          dead;
+} arena_t;
+
+arena_t * arena_new (void);
+gpointer arena_alloc (arena_t *arena, gsize size);
+char * arena_strdup (arena_t *arena, const char *str);
+char * arena_intern (arena_t *arena, const char *str);
+void arena_release (arena_t *arena, gsize size);
+gsize arena_get_size (arena_t *arena);
+gsize arena_get_dead (arena_t *arena);
+void arena_free (arena_t *arena);
+
+#endif /* _PKGCLIP_ARENA_H */
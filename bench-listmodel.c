@@ -0,0 +1,265 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * bench-listmodel.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+
+#include "config.h"
+
+/* C */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* pkgclip */
+#include "pkgclip.h"
+#include "listmodel.h"
+
+/* Times filling the list (a PcListModel, sorted, shown in a GtkTreeView) with
+ * N synthetic packages, the different ways it can be done:
+ * - detached: the model is detached from the view, loaded with
+ *   pc_list_model_load_rows, and given back; as done on refresh;
+ * - batches: rows added with pc_list_model_append_rows while attached, by
+ *   batches of 256; as done while loading;
+ * - per row: rows added one at a time with pc_list_model_insert while
+ *   attached; as done for files showing up in the cache (only up to 100000
+ *   rows, it is quadratic);
+ * - list store: what was done before PcListModel, i.e. a GtkListStore (sorted
+ *   on the same column) with each row appended & set while attached.
+ *
+ * Usage: bench-listmodel [N...]   (default: 10000 100000 1000000)
+ */
+
+#define BATCH           256
+#define MAX_PER_ROW     100000
+
+static pc_pkg_t *
+new_packages (guint n)
+{
+    pc_pkg_t *pkgs;
+    guint i;
+
+    pkgs = g_new0 (pc_pkg_t, n);
+    for (i = 0; i < n; ++i)
+    {
+        pkgs[i].name = (char *) "package";
+        pkgs[i].version = (char *) "1.0-1";
+        pkgs[i].desc = (char *) "";
+        pkgs[i].file = (char *) "/var/cache/pacman/pkg/package-1.0-1-any.pkg.tar.zst";
+        /* sorted on size, so rows end up all over the place */
+        pkgs[i].filesize = (off_t) g_random_int_range (1, 100 * 1024 * 1024);
+    }
+    return pkgs;
+}
+
+static GtkWidget *
+new_view (PcListModel **store)
+{
+    GtkWidget *list;
+
+    *store = pc_list_model_new ();
+    gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (*store),
+            COL_SIZE, GTK_SORT_ASCENDING);
+    list = gtk_tree_view_new_with_model (GTK_TREE_MODEL (*store));
+    g_object_ref_sink (list);
+    return list;
+}
+
+static double
+bench_detached (pc_pkg_t *pkgs, guint n)
+{
+    PcListModel *store;
+    GtkWidget *list;
+    GPtrArray *packages;
+    GTimer *timer;
+    double elapsed;
+    guint i;
+
+    packages = g_ptr_array_sized_new (n);
+    for (i = 0; i < n; ++i)
+        g_ptr_array_add (packages, &pkgs[i]);
+    list = new_view (&store);
+
+    /* same as load_list_model */
+    timer = g_timer_new ();
+    g_object_ref (store);
+    gtk_tree_view_set_model (GTK_TREE_VIEW (list), NULL);
+    pc_list_model_load_rows (store, packages);
+    gtk_tree_view_set_model (GTK_TREE_VIEW (list), GTK_TREE_MODEL (store));
+    g_object_unref (store);
+    elapsed = g_timer_elapsed (timer, NULL);
+
+    g_timer_destroy (timer);
+    g_object_unref (list);
+    g_object_unref (store);
+    g_ptr_array_unref (packages);
+    return elapsed;
+}
+
+static double
+bench_batches (pc_pkg_t *pkgs, guint n)
+{
+    PcListModel *store;
+    GtkWidget *list;
+    GPtrArray *batch;
+    GTimer *timer;
+    double elapsed;
+    guint i;
+
+    batch = g_ptr_array_sized_new (BATCH);
+    list = new_view (&store);
+
+    timer = g_timer_new ();
+    for (i = 0; i < n; ++i)
+    {
+        g_ptr_array_add (batch, &pkgs[i]);
+        if (batch->len == BATCH || i + 1 == n)
+        {
+            pc_list_model_append_rows (store, batch);
+            g_ptr_array_set_size (batch, 0);
+        }
+    }
+    elapsed = g_timer_elapsed (timer, NULL);
+
+    g_timer_destroy (timer);
+    g_object_unref (list);
+    g_object_unref (store);
+    g_ptr_array_unref (batch);
+    return elapsed;
+}
+
+static double
+bench_per_row (pc_pkg_t *pkgs, guint n)
+{
+    PcListModel *store;
+    GtkWidget *list;
+    GTimer *timer;
+    double elapsed;
+    guint i;
+
+    list = new_view (&store);
+
+    timer = g_timer_new ();
+    for (i = 0; i < n; ++i)
+        pc_list_model_insert (store, &pkgs[i]);
+    elapsed = g_timer_elapsed (timer, NULL);
+
+    g_timer_destroy (timer);
+    g_object_unref (list);
+    g_object_unref (store);
+    return elapsed;
+}
+
+static double
+bench_list_store (pc_pkg_t *pkgs, guint n)
+{
+    GtkListStore *store;
+    GtkWidget *list;
+    GtkTreeIter iter;
+    GTimer *timer;
+    double elapsed;
+    guint i;
+
+    /* same as the list used to be */
+    store = gtk_list_store_new (COL_NB,
+            G_TYPE_POINTER, /* pc_pkg */
+            G_TYPE_STRING,  /* package */
+            G_TYPE_STRING,  /* version */
+            G_TYPE_UINT,    /* size */
+            G_TYPE_BOOLEAN, /* remove */
+            G_TYPE_INT,     /* recomm */
+            G_TYPE_INT,     /* reason */
+            G_TYPE_INT,     /* nb old ver */
+            G_TYPE_INT      /* nb old ver total */
+            );
+    gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+            COL_SIZE, GTK_SORT_ASCENDING);
+    list = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+    g_object_ref_sink (list);
+
+    timer = g_timer_new ();
+    for (i = 0; i < n; ++i)
+    {
+        gtk_list_store_append (store, &iter);
+        gtk_list_store_set (store, &iter,
+                COL_PC_PKG,             &pkgs[i],
+                COL_PACKAGE,            pkgs[i].name,
+                COL_VERSION,            pkgs[i].version,
+                COL_SIZE,               (guint) pkgs[i].filesize,
+                COL_RECOMM,             pkgs[i].recomm,
+                COL_REMOVE,             pkgs[i].remove,
+                COL_REASON,             pkgs[i].reason,
+                COL_NB_OLD_VER,         pkgs[i].nb_old_ver,
+                COL_NB_OLD_VER_TOTAL,   pkgs[i].nb_old_ver_total,
+                -1);
+    }
+    elapsed = g_timer_elapsed (timer, NULL);
+
+    g_timer_destroy (timer);
+    g_object_unref (list);
+    g_object_unref (store);
+    return elapsed;
+}
+
+int
+main (int argc, char *argv[])
+{
+    static const char *defaults[] = { "10000", "100000", "1000000" };
+    const char **sizes = (const char **) argv + 1;
+    int nb_sizes = argc - 1;
+    int i;
+
+    if (!gtk_init_check (&argc, &argv))
+    {
+        fprintf (stderr, "Cannot open display\n");
+        return 1;
+    }
+    if (nb_sizes == 0)
+    {
+        sizes = defaults;
+        nb_sizes = (int) G_N_ELEMENTS (defaults);
+    }
+    /* same data for each run */
+    g_random_set_seed (42);
+
+    printf ("%10s %12s %12s %12s %12s\n", "rows", "detached", "batches",
+            "per row", "list store");
+    for (i = 0; i < nb_sizes; ++i)
+    {
+        pc_pkg_t *pkgs;
+        guint n;
+
+        n = (guint) strtoul (sizes[i], NULL, 10);
+        if (n == 0)
+            continue;
+        pkgs = new_packages (n);
+
+        printf ("%10u %11.3fs", n, bench_detached (pkgs, n));
+        printf (" %11.3fs", bench_batches (pkgs, n));
+        if (n <= MAX_PER_ROW)
+            printf (" %11.3fs", bench_per_row (pkgs, n));
+        else
+            printf (" %12s", "-");
+        printf (" %11.3fs\n", bench_list_store (pkgs, n));
+        fflush (stdout);
+
+        g_free (pkgs);
+    }
+    return 0;
+}
@@ -0,0 +1,503 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * cli.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+
+#include "config.h"
+
+/* C */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h> /* PATH_MAX */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdint.h>
+
+/* pkgclip */
+#include "common.h"
+#include "util.h"
+#include "snapshot.h"
+#include "arena.h"
+#include "scan.h"
+#include "cli.h"
+
+/* Headless mode: same scan & classification as the GUI, results printed on
+ * stdout. Meant to be used from scripts/cron on machines without a display, so
+ * nothing in here may use GTK (which isn't even initialized).
+ */
+
+typedef enum {
+    CLI_LIST,
+    CLI_DRY_RUN,
+    CLI_REMOVE
+} cli_mode_t;
+
+typedef struct _totals_t {
+    unsigned int nb;
+    off_t        size;
+    unsigned int nb_marked;
+    off_t        size_marked;
+} totals_t;
+
+struct _cli_t;
+/* prints one record, for a package listed/to be removed/removed */
+typedef void (*print_record_fn) (pc_pkg_t *pc_pkg, struct _cli_t *cli);
+
+typedef struct _format_t {
+    const char      *name;
+    /* printed once, before any record; can be NULL */
+    const char      *header;
+    print_record_fn  print_record;
+    /* whether the summary goes to stdout, or stderr not to mix with records */
+    gboolean         summary_stdout;
+} format_t;
+
+typedef struct _cli_t {
+    cli_mode_t       mode;
+    const format_t  *format;
+    pkgclip_t       *pkgclip;
+    totals_t         totals[NB_REASONS];
+    totals_t         removed;
+} cli_t;
+
+static gboolean   opt_list          = FALSE;
+static gboolean   opt_dry_run       = FALSE;
+static gboolean   opt_remove        = FALSE;
+static gchar     *opt_format        = NULL;
+static gint       opt_nb_old_ver    = -1;
+static gint       opt_nb_old_ver_ai = -1;
+static gchar    **opt_as_installed  = NULL;
+static gchar    **opt_recomm        = NULL;
+
+static GOptionEntry entries[] = {
+    { "list", 0, 0, G_OPTION_ARG_NONE, &opt_list,
+        "List all packages with their recommendation and reason", NULL },
+    { "dry-run", 0, 0, G_OPTION_ARG_NONE, &opt_dry_run,
+        "List the files that would be removed", NULL },
+    { "remove", 0, 0, G_OPTION_ARG_NONE, &opt_remove,
+        "Remove the files of all packages recommended for removal", NULL },
+    { "format", 0, 0, G_OPTION_ARG_STRING, &opt_format,
+        "Output format: text (default), jsonl, csv or nul", "FORMAT" },
+    { "nb-old-versions", 0, 0, G_OPTION_ARG_INT, &opt_nb_old_ver,
+        "Number of old versions to keep", "N" },
+    { "nb-old-versions-ai", 0, 0, G_OPTION_ARG_INT, &opt_nb_old_ver_ai,
+        "Number of old versions to keep for packages treated as installed", "N" },
+    { "as-installed", 0, 0, G_OPTION_ARG_STRING_ARRAY, &opt_as_installed,
+        "Treat PKG as if it was installed (replaces the configured list)", "PKG" },
+    { "recomm", 0, 0, G_OPTION_ARG_STRING_ARRAY, &opt_recomm,
+        "Set the recommendation for a reason, e.g. OlderPkgrel=Keep",
+        "REASON=Keep|Remove" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+/* set if something went wrong, to be reflected in the exit code */
+static gboolean failed = FALSE;
+
+gboolean
+is_headless (int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        GOptionEntry *e;
+        size_t len;
+
+        if (strncmp (argv[i], "--", 2) != 0)
+            continue;
+        len = strcspn (argv[i] + 2, "=");
+        for (e = entries; e->long_name; ++e)
+            if (strlen (e->long_name) == len
+                    && strncmp (argv[i] + 2, e->long_name, len) == 0)
+                return TRUE;
+    }
+    return FALSE;
+}
+
+static void
+dir_error (const char *cachedir, pkgclip_t *pkgclip _UNUSED_)
+{
+    fprintf (stderr, "Could not access cache directory %s\n", cachedir);
+    failed = TRUE;
+}
+
+static gboolean
+apply_overrides (pkgclip_t *pkgclip)
+{
+    gchar **s;
+
+    if (opt_nb_old_ver >= 0)
+        pkgclip->nb_old_ver = opt_nb_old_ver;
+    if (opt_nb_old_ver_ai >= 0)
+        pkgclip->nb_old_ver_ai = opt_nb_old_ver_ai;
+
+    if (opt_as_installed)
+    {
+        FREELIST (pkgclip->as_installed);
+        for (s = opt_as_installed; *s; ++s)
+            pkgclip->as_installed = alpm_list_add (pkgclip->as_installed,
+                    strdup (*s));
+    }
+
+    for (s = opt_recomm; s && *s; ++s)
+    {
+        char *eq = strchr (*s, '=');
+
+        if (eq)
+            *eq = '\0';
+        if (!eq || !set_recomm (*s, eq + 1, pkgclip))
+        {
+            if (eq)
+                *eq = '=';
+            fprintf (stderr, "Invalid recommendation: %s\n", *s);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* puts the path of the .sig file of pc_pkg in buf (PATH_MAX); returns whether
+ * there is one, and it is to be removed alongside the package */
+static gboolean
+get_sig (pc_pkg_t *pc_pkg, char *buf, pkgclip_t *pkgclip)
+{
+    struct stat sb;
+
+    return pkgclip->remove_sig
+        && snprintf (buf, PATH_MAX, "%s.sig", pc_pkg->file) < PATH_MAX
+        && stat (buf, &sb) == 0;
+}
+
+static void
+print_text (pc_pkg_t *pc_pkg, cli_t *cli)
+{
+    char b[PATH_MAX];
+
+    if (cli->mode == CLI_LIST)
+        printf ("%s\t%s\t%s\n", (pc_pkg->remove) ? "remove" : "keep",
+                reason_keys[pc_pkg->reason], pc_pkg->file);
+    else if (cli->mode == CLI_DRY_RUN)
+    {
+        printf ("%s\n", pc_pkg->file);
+        if (get_sig (pc_pkg, b, cli->pkgclip))
+            printf ("%s\n", b);
+    }
+    /* nothing for removed files, only errors are reported */
+}
+
+static void
+print_nul (pc_pkg_t *pc_pkg, cli_t *cli)
+{
+    char b[PATH_MAX];
+
+    fputs (pc_pkg->file, stdout);
+    putchar ('\0');
+    if (cli->mode == CLI_DRY_RUN && get_sig (pc_pkg, b, cli->pkgclip))
+    {
+        fputs (b, stdout);
+        putchar ('\0');
+    }
+}
+
+static void
+print_json_string (const char *s)
+{
+    putchar ('"');
+    for ( ; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            printf ("\\%c", *s);
+        else if ((unsigned char) *s < 0x20)
+            printf ("\\u%04x", (unsigned char) *s);
+        else
+            putchar (*s);
+    }
+    putchar ('"');
+}
+
+static void
+print_jsonl (pc_pkg_t *pc_pkg, cli_t *cli _UNUSED_)
+{
+    fputs ("{\"file\":", stdout);
+    print_json_string (pc_pkg->file);
+    fputs (",\"name\":", stdout);
+    print_json_string (pc_pkg->name);
+    fputs (",\"version\":", stdout);
+    print_json_string (pc_pkg->version);
+    printf (",\"size\":%jd,\"reason\":\"%s\",\"recomm\":\"%s\",\"old_ver\":%d}\n",
+            (intmax_t) pc_pkg->filesize,
+            reason_keys[pc_pkg->reason],
+            (pc_pkg->recomm == RECOMM_REMOVE) ? "remove" : "keep",
+            pc_pkg->nb_old_ver);
+}
+
+static void
+print_csv_field (const char *s)
+{
+    if (!strpbrk (s, ",\"\r\n"))
+    {
+        fputs (s, stdout);
+        return;
+    }
+
+    putchar ('"');
+    for ( ; *s; ++s)
+    {
+        if (*s == '"')
+            putchar ('"');
+        putchar (*s);
+    }
+    putchar ('"');
+}
+
+static void
+print_csv (pc_pkg_t *pc_pkg, cli_t *cli _UNUSED_)
+{
+    print_csv_field (pc_pkg->file);
+    putchar (',');
+    print_csv_field (pc_pkg->name);
+    putchar (',');
+    print_csv_field (pc_pkg->version);
+    printf (",%jd,%s,%s,%d\n",
+            (intmax_t) pc_pkg->filesize,
+            reason_keys[pc_pkg->reason],
+            (pc_pkg->recomm == RECOMM_REMOVE) ? "remove" : "keep",
+            pc_pkg->nb_old_ver);
+}
+
+static const format_t formats[] = {
+    { "text",  NULL, print_text, TRUE },
+    { "jsonl", NULL, print_jsonl, FALSE },
+    { "csv", "file,name,version,size,reason,recomm,old_ver\n", print_csv, FALSE },
+    { "nul",   NULL, print_nul, FALSE },
+    { NULL,    NULL, NULL, FALSE }
+};
+
+static gboolean
+remove_file (const char *file, gboolean must_exist, totals_t *removed)
+{
+    struct stat sb;
+
+    if (lstat (file, &sb) < 0)
+    {
+        if (must_exist || errno != ENOENT)
+        {
+            fprintf (stderr, "%s: %s\n", file, strerror (errno));
+            failed = TRUE;
+        }
+        return FALSE;
+    }
+
+    if (unlink (file) < 0)
+    {
+        fprintf (stderr, "%s: %s\n", file, strerror (errno));
+        failed = TRUE;
+        return FALSE;
+    }
+    ++(removed->nb);
+    removed->size += sb.st_size;
+    return TRUE;
+}
+
+/* returns whether the package file itself was removed */
+static gboolean
+remove_package (const char *file, pkgclip_t *pkgclip, totals_t *removed)
+{
+    char b[PATH_MAX];
+
+    if (!remove_file (file, TRUE, removed))
+        return FALSE;
+    if (pkgclip->remove_sig && snprintf (b, PATH_MAX, "%s.sig", file) < PATH_MAX)
+        remove_file (b, FALSE, removed);
+    return TRUE;
+}
+
+/* handles all packages in [first, last), once they've been classified */
+static void
+process_group (guint first, guint last, cli_t *cli)
+{
+    guint i;
+
+    for (i = first; i < last; ++i)
+    {
+        pc_pkg_t *pc_pkg = g_ptr_array_index (cli->pkgclip->packages, i);
+        totals_t *t = &cli->totals[pc_pkg->reason];
+
+        ++(t->nb);
+        t->size += pc_pkg->filesize;
+        if (pc_pkg->remove)
+        {
+            ++(t->nb_marked);
+            t->size_marked += pc_pkg->filesize;
+        }
+
+        if (cli->mode == CLI_LIST
+                || (cli->mode == CLI_DRY_RUN && pc_pkg->remove)
+                || (cli->mode == CLI_REMOVE && pc_pkg->remove
+                    && remove_package (pc_pkg->file, cli->pkgclip, &cli->removed)))
+            cli->format->print_record (pc_pkg, cli);
+    }
+}
+
+static void
+print_size (FILE *fp, off_t size)
+{
+    const char *unit;
+    double hsize;
+
+    hsize = humanize_size (size, '\0', &unit);
+    fprintf (fp, "  %8.2f %-3s", hsize, unit);
+}
+
+static void
+print_totals (cli_t *cli)
+{
+    FILE *fp = (cli->format->summary_stdout) ? stdout : stderr;
+    totals_t all = { 0, 0, 0, 0 };
+    int i;
+
+    /* don't have the summary show up in the middle of the records */
+    fflush (stdout);
+
+    fprintf (fp, "\n%-20s %8s %14s %8s %14s\n",
+            "Reason", "Files", "Size", "Marked", "Size");
+    for (i = 0; i < NB_REASONS; ++i)
+    {
+        totals_t *t = &cli->totals[i];
+
+        fprintf (fp, "%-20s %8u", reason_keys[i], t->nb);
+        print_size (fp, t->size);
+        fprintf (fp, " %8u", t->nb_marked);
+        print_size (fp, t->size_marked);
+        fprintf (fp, "\n");
+
+        all.nb += t->nb;
+        all.size += t->size;
+        all.nb_marked += t->nb_marked;
+        all.size_marked += t->size_marked;
+    }
+    fprintf (fp, "%-20s %8u", "Total", all.nb);
+    print_size (fp, all.size);
+    fprintf (fp, " %8u", all.nb_marked);
+    print_size (fp, all.size_marked);
+    fprintf (fp, "\n");
+
+    if (cli->mode == CLI_REMOVE)
+    {
+        fprintf (fp, "\nRemoved %u files,", cli->removed.nb);
+        print_size (fp, cli->removed.size);
+        fprintf (fp, "\n");
+    }
+}
+
+int
+run_headless (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    pkgclip_t *pkgclip;
+    cli_t cli;
+    guint i, last;
+
+    context = g_option_context_new ("- " PACKAGE_TAG);
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return 2;
+    }
+    g_option_context_free (context);
+
+    if (opt_list + opt_dry_run + opt_remove != 1)
+    {
+        fprintf (stderr, "Exactly one of --list, --dry-run or --remove is required\n");
+        return 2;
+    }
+
+    memset (&cli, 0, sizeof (cli));
+    cli.mode = (opt_list) ? CLI_LIST : (opt_dry_run) ? CLI_DRY_RUN : CLI_REMOVE;
+    cli.format = &formats[0];
+    if (opt_format)
+    {
+        for ( ; cli.format->name; ++cli.format)
+            if (strcmp (cli.format->name, opt_format) == 0)
+                break;
+        if (!cli.format->name)
+        {
+            fprintf (stderr, "Invalid format: %s\n", opt_format);
+            return 2;
+        }
+    }
+
+    pkgclip = new_pkgclip (NULL);
+    cli.pkgclip = pkgclip;
+    if (!apply_overrides (pkgclip))
+    {
+        free_pkgclip (pkgclip);
+        return 2;
+    }
+    /* no files index: nothing ever looks packages up by path in here */
+    pkgclip->packages = g_ptr_array_new ();
+    pkgclip->arena = arena_new ();
+    if (init_alpm (pkgclip) < 0)
+    {
+        g_ptr_array_unref (pkgclip->packages);
+        arena_free (pkgclip->arena);
+        free_pkgclip (pkgclip);
+        return 1;
+    }
+
+    scan_packages (dir_error, NULL, pkgclip);
+
+    /* records are printed as soon as a package (i.e. all its versions) has been
+     * classified, instead of once everything is */
+    if (cli.format->header)
+        fputs (cli.format->header, stdout);
+    prepare_snapshot (pkgclip);
+    for (i = 0; i < pkgclip->packages->len; i = last)
+    {
+        last = get_group_end (i, pkgclip);
+        classify_group (i, last, NULL, NULL, pkgclip);
+        process_group (i, last, &cli);
+    }
+
+    print_totals (&cli);
+
+    if (pkgclip->handle && alpm_release (pkgclip->handle) == -1)
+        fprintf (stderr, "Failed to properly release ALPM library\n");
+    scan_free_cache (pkgclip);
+    g_ptr_array_unref (pkgclip->packages);
+    arena_free (pkgclip->arena);
+    if (pkgclip->snapshot)
+        snapshot_free (pkgclip->snapshot);
+    free_pkgclip (pkgclip);
+    g_free (opt_format);
+    g_strfreev (opt_as_installed);
+    g_strfreev (opt_recomm);
+
+    return (failed) ? 1 : 0;
+}
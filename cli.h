@@ -0,0 +1,30 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * cli.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+
+#ifndef _PKGCLIP_CLI_H
+#define _PKGCLIP_CLI_H
+
+gboolean is_headless (int argc, char *argv[]);
+int run_headless (int argc, char *argv[]);
+
+#endif /* _PKGCLIP_CLI_H */
@@ -0,0 +1,205 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * common.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef _PKGCLIP_COMMON_H
+#define _PKGCLIP_COMMON_H
+
+/* What's shared by the GUI and pkgclip-cli, so no GTK in here: widgets are only
+ * known as pointers to incomplete types, see pkgclip.h for the rest. */
+
+/* glib */
+#include <glib.h>
+
+/* gio - for file monitors & dbus */
+#include <gio/gio.h>
+
+/* alpm */
+#include <alpm.h>
+#include <alpm_list.h>
+
+/* pkgclip */
+#include "version.h"
+
+#if defined(GIT_VERSION)
+#undef PACKAGE_VERSION
+#define PACKAGE_VERSION GIT_VERSION
+#endif
+#define PACKAGE_TAG             "Cached Packages Trimmer Utility"
+
+#define PACMAN_CONF             "/etc"
+#define ROOT_PATH               "/"
+#define DB_PATH                 "/var/lib/pacman/"
+#define CACHE_PATH              "/var/cache/pacman/pkg/"
+
+#define _UNUSED_                __attribute__ ((unused)) 
+
+typedef enum {
+    RECOMM_KEEP,
+    RECOMM_REMOVE
+} recomm_t;
+
+typedef enum {
+    REASON_AS_INSTALLED,
+    REASON_NEWER_THAN_INSTALLED,
+    REASON_INSTALLED,
+    REASON_OLDER_VERSION,
+    REASON_ALREADY_OLDER_VERSION,
+    REASON_OLDER_PKGREL,
+    REASON_PKG_NOT_INSTALLED,
+    NB_REASONS
+} reason_t;
+
+typedef enum {
+    VAR_NAME,
+    VAR_DESC,
+    VAR_VERSION,
+    VAR_FILE,
+    VAR_SIZE,
+    VAR_RECOMM,
+    VAR_REASON,
+} info_var_t;
+
+/* to tell whether pacman.conf or the databases changed (see refresh_alpm) */
+typedef struct _alpm_token_t {
+    guint64 conf_dev;
+    guint64 conf_ino;
+    gint64  conf_mtime;
+    gint64  local_mtime;
+    guint64 local_nlink;
+    gint64  sync_mtime;
+} alpm_token_t;
+
+/* see listmodel.h */
+typedef struct _PcListModel PcListModel;
+
+typedef struct _pkgclip_t {
+    /* config */
+    char            *pacmanconf;
+    char            *dbpath;
+    char            *rootpath;
+    alpm_list_t     *cachedirs;
+    alpm_list_t     *syncdbs;
+    gboolean         autoload;
+    gboolean         fast_scan;
+    gboolean         watch_cache;
+    gboolean         old_pkgrel;
+    recomm_t         recomm[NB_REASONS];
+    int              nb_old_ver;
+    alpm_list_t     *as_installed;
+    int              nb_old_ver_ai;
+    gboolean         show_pkg_info;
+    char            *pkg_info;
+    alpm_list_t     *pkg_info_extras;
+    gboolean         remove_sig;
+    int              scan_threads;
+
+    /* app/gui */
+    gboolean         headless;
+    /* how errors are shown in the GUI; NULL in headless mode (see show_error) */
+    void           (*show_error) (const gchar *message, const gchar *submessage,
+                                  struct _pkgclip_t *pkgclip);
+    gboolean         in_gtk_main;
+    gboolean         is_loading;
+    /* files that changed in the cachedirs are being loaded (see sync_cachedirs) */
+    gboolean         is_syncing;
+    gboolean         abort;
+    struct _GtkWidget *window;
+    PcListModel     *store;
+    struct _GtkWidget *list;
+    struct _GtkWidget *label;
+    struct _GtkWidget *button;
+    struct _GtkWidget *mnu_reload;
+    struct _GtkWidget *mnu_remove;
+    struct _GtkWidget *mnu_edit;
+    struct _GtkWidget *sep_pkg_info;
+    struct _GtkWidget *lbl_pkg_info;
+
+    gulong           handler_pkg_info;
+    GString         *str_info;
+
+    struct _prefs_win_t *prefs;
+
+    alpm_handle_t   *handle;
+    alpm_token_t     token;
+    struct _snapshot_t *snapshot;
+    GPtrArray       *packages;
+    /* where packages (& their strings) live; replaced on each full reload */
+    struct _arena_t *arena;
+    /* file path -> pc_pkg_t */
+    GHashTable      *files;
+    /* metadata cache & sync index of the last full scan, kept for files loaded
+     * afterwards (see scan_load_files) until the next one */
+    struct _mdcache_t *mdcache;
+    struct _sync_index_t *syncidx;
+    /* batches of packages while loading (see scan_packages) */
+    GAsyncQueue     *loading;
+    /* files found/packages loaded so far, atomic */
+    gint             nb_found;
+    gint             nb_loaded;
+
+    /* GFileMonitor for each cachedir, and paths of files that changed since
+     * (see sync_cachedirs) */
+    GPtrArray       *monitors;
+    GHashTable      *dirty;
+    guint            dirty_id;
+    /* reload asked for while locked, to be done once unlocked */
+    guint            reload_id;
+    /* GFileMonitor for the local db (see refresh_db) */
+    GFileMonitor    *db_monitor;
+    guint            db_id;
+
+    unsigned int     total_packages;
+    off_t            total_size;
+    unsigned int     marked_packages;
+    off_t            marked_size;
+
+    gboolean         locked;
+    struct _progress_win_t *progress_win;
+
+    GDBusProxy      *proxy;
+} pkgclip_t;
+
+typedef struct _pc_pkg_t {
+    char *file;
+    off_t filesize;
+    /* to tell whether the file was replaced since (see pc_pkg_same_file) */
+    guint64 ino;
+    gint64 mtime;
+    char *name;
+    char *version;
+    pc_ver_t ver;
+    char *desc;
+    recomm_t recomm;
+    reason_t reason;
+    int nb_old_ver;
+    int nb_old_ver_total;
+    gboolean remove;
+    /* reason/recomm are set; not while loading packages */
+    gboolean classified;
+    /* file was removed, record to be dropped (see compact_packages) */
+    gboolean removed;
+    /* index in the list model */
+    guint row;
+} pc_pkg_t;
+
+
+#endif /* _PKGCLIP_COMMON_H */
@@ -0,0 +1,139 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * dialog.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+/* pkgclip */
+#include "pkgclip.h"
+#include "dialog.h"
+
+/* Dialogs of the GUI. Errors are shown through show_error() (see util.c), so
+ * code shared with pkgclip-cli doesn't need GTK.
+ */
+
+gboolean
+confirm (const gchar *message,
+         const gchar *submessage,
+         const gchar *btn_yes_label,
+         const gchar *btn_yes_image,
+         const gchar *btn_no_label,
+         const gchar *btn_no_image,
+         pkgclip_t *pkgclip
+         )
+{
+    GtkWidget *dialog;
+    GtkWidget *button;
+    GtkWidget *image;
+    gint       rc;
+
+    if (NULL == submessage)
+    {
+        dialog = gtk_message_dialog_new_with_markup (
+                GTK_WINDOW(pkgclip->window),
+                GTK_DIALOG_DESTROY_WITH_PARENT,
+                GTK_MESSAGE_QUESTION,
+                GTK_BUTTONS_NONE,
+                NULL);
+        gtk_message_dialog_set_markup (GTK_MESSAGE_DIALOG(dialog), message);
+    }
+    else
+    {
+        dialog = gtk_message_dialog_new (
+                GTK_WINDOW(pkgclip->window),
+                GTK_DIALOG_DESTROY_WITH_PARENT,
+                GTK_MESSAGE_QUESTION,
+                GTK_BUTTONS_NONE,
+                "%s",
+                message);
+        gtk_message_dialog_format_secondary_markup (
+                GTK_MESSAGE_DIALOG(dialog),
+                "%s",
+                submessage);
+    }
+
+    gtk_window_set_decorated (GTK_WINDOW(dialog), FALSE);
+    gtk_window_set_skip_taskbar_hint (GTK_WINDOW(dialog), TRUE);
+    gtk_window_set_skip_pager_hint (GTK_WINDOW(dialog), TRUE);
+
+    button = gtk_dialog_add_button(
+            GTK_DIALOG(dialog),
+            (NULL == btn_no_label) ? "No" : btn_no_label,
+            GTK_RESPONSE_NO);
+    image = gtk_image_new_from_icon_name (
+            (NULL == btn_no_image) ? "gtk-no" : btn_no_image,
+            GTK_ICON_SIZE_MENU);
+    gtk_button_set_image( GTK_BUTTON(button), image);
+
+    button = gtk_dialog_add_button(
+            GTK_DIALOG(dialog),
+            (NULL == btn_yes_label) ? "Yes" : btn_yes_label,
+            GTK_RESPONSE_YES);
+    image = gtk_image_new_from_icon_name (
+            (NULL == btn_yes_image) ? "gtk-yes" : btn_yes_image,
+            GTK_ICON_SIZE_MENU);
+    gtk_button_set_image( GTK_BUTTON(button), image);
+
+    gtk_dialog_set_default_response(GTK_DIALOG(dialog), GTK_RESPONSE_NO);
+    rc = gtk_dialog_run (GTK_DIALOG(dialog));
+    gtk_widget_destroy (dialog);
+    return rc == GTK_RESPONSE_YES;
+}
+
+void
+show_error_dialog (const gchar *message, const gchar *submessage,
+                   pkgclip_t *pkgclip)
+{
+    GtkWidget *dialog;
+
+    if (NULL == submessage)
+    {
+        dialog = gtk_message_dialog_new_with_markup (
+                GTK_WINDOW(pkgclip->window),
+                GTK_DIALOG_DESTROY_WITH_PARENT,
+                GTK_MESSAGE_ERROR,
+                GTK_BUTTONS_OK,
+                NULL);
+        gtk_message_dialog_set_markup (GTK_MESSAGE_DIALOG(dialog), message);
+    }
+    else
+    {
+        dialog = gtk_message_dialog_new (
+                GTK_WINDOW(pkgclip->window),
+                GTK_DIALOG_DESTROY_WITH_PARENT,
+                GTK_MESSAGE_ERROR,
+                GTK_BUTTONS_OK,
+                "%s",
+                message);
+        gtk_message_dialog_format_secondary_markup (
+                GTK_MESSAGE_DIALOG(dialog),
+                "%s",
+                submessage);
+    }
+
+    gtk_window_set_decorated (GTK_WINDOW(dialog), FALSE);
+    gtk_window_set_skip_taskbar_hint (GTK_WINDOW(dialog), TRUE);
+    gtk_window_set_skip_pager_hint (GTK_WINDOW(dialog), TRUE);
+
+    g_signal_connect_swapped (dialog, "response",
+            G_CALLBACK (gtk_widget_destroy), dialog);
+    gtk_widget_show_all (dialog);
+}
@@ -0,0 +1,33 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * dialog.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef _PKGCLIP_DIALOG_H
+#define _PKGCLIP_DIALOG_H
+
+void show_error_dialog (const gchar *message, const gchar *submessage,
+                        pkgclip_t *pkgclip);
+gboolean confirm (const gchar *message, const gchar *submessage,
+                  const gchar *btn_yes_label, const gchar *btn_yes_image,
+                  const gchar *btn_no_label, const gchar *btn_no_image,
+                  pkgclip_t *pkgclip);
+
+#endif /* _PKGCLIP_DIALOG_H */
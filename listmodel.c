@@ -0,0 +1,808 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * listmodel.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+/* C */
+#include <string.h>
+
+/* pkgclip */
+#include "pkgclip.h"
+#include "listmodel.h"
+
+struct _PcListModel {
+    GObject      parent;
+
+    /* pc_pkg_t in display order; not owned */
+    GPtrArray   *rows;
+    gint         stamp;
+    /* while frozen, rows changed are only resorted on thaw, all at once */
+    guint        frozen;
+    GPtrArray   *changed;
+
+    /* GtkTreeSortable */
+    gint                    sort_col;
+    GtkSortType             sort_order;
+    GtkTreeIterCompareFunc  sort_func[COL_NB];
+    gpointer                sort_data[COL_NB];
+    GDestroyNotify          sort_destroy[COL_NB];
+    GtkTreeIterCompareFunc  default_sort_func;
+    gpointer                default_sort_data;
+    GDestroyNotify          default_sort_destroy;
+};
+
+static void pc_list_model_tree_model_init (GtkTreeModelIface *iface);
+static void pc_list_model_tree_sortable_init (GtkTreeSortableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (PcListModel, pc_list_model, G_TYPE_OBJECT,
+        G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+            pc_list_model_tree_model_init)
+        G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_SORTABLE,
+            pc_list_model_tree_sortable_init))
+
+#define ROW(model, i)   ((pc_pkg_t *) g_ptr_array_index ((model)->rows, (i)))
+
+static void
+set_iter (PcListModel *model, GtkTreeIter *iter, pc_pkg_t *pc_pkg)
+{
+    iter->stamp = model->stamp;
+    iter->user_data = pc_pkg;
+    iter->user_data2 = NULL;
+    iter->user_data3 = NULL;
+}
+
+static gboolean
+set_iter_nth (PcListModel *model, GtkTreeIter *iter, gint n)
+{
+    if (n < 0 || (guint) n >= model->rows->len)
+    {
+        iter->stamp = 0;
+        return FALSE;
+    }
+    set_iter (model, iter, ROW (model, n));
+    return TRUE;
+}
+
+/* GtkTreeModel */
+
+static GtkTreeModelFlags
+pc_list_model_get_flags (GtkTreeModel *tree_model _UNUSED_)
+{
+    return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint
+pc_list_model_get_n_columns (GtkTreeModel *tree_model _UNUSED_)
+{
+    return COL_NB;
+}
+
+static GType
+pc_list_model_get_column_type (GtkTreeModel *tree_model _UNUSED_, gint index)
+{
+    switch (index)
+    {
+        case COL_PC_PKG:
+            return G_TYPE_POINTER;
+        case COL_PACKAGE:
+        case COL_VERSION:
+            return G_TYPE_STRING;
+        case COL_SIZE:
+            return G_TYPE_UINT;
+        case COL_REMOVE:
+            return G_TYPE_BOOLEAN;
+        case COL_RECOMM:
+        case COL_REASON:
+        case COL_NB_OLD_VER:
+        case COL_NB_OLD_VER_TOTAL:
+            return G_TYPE_INT;
+        default:
+            return G_TYPE_INVALID;
+    }
+}
+
+static gboolean
+pc_list_model_get_iter (GtkTreeModel *tree_model, GtkTreeIter *iter,
+                        GtkTreePath *path)
+{
+    if (gtk_tree_path_get_depth (path) != 1)
+    {
+        iter->stamp = 0;
+        return FALSE;
+    }
+    return set_iter_nth (PC_LIST_MODEL (tree_model), iter,
+            gtk_tree_path_get_indices (path)[0]);
+}
+
+static GtkTreePath *
+pc_list_model_get_path (GtkTreeModel *tree_model _UNUSED_, GtkTreeIter *iter)
+{
+    pc_pkg_t *pc_pkg = iter->user_data;
+
+    return gtk_tree_path_new_from_indices ((gint) pc_pkg->row, -1);
+}
+
+static void
+pc_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter,
+                         gint column, GValue *value)
+{
+    pc_pkg_t *pc_pkg = iter->user_data;
+
+    g_value_init (value, pc_list_model_get_column_type (tree_model, column));
+    switch (column)
+    {
+        case COL_PC_PKG:
+            g_value_set_pointer (value, pc_pkg);
+            break;
+        case COL_PACKAGE:
+            g_value_set_string (value, pc_pkg->name);
+            break;
+        case COL_VERSION:
+            g_value_set_string (value, pc_pkg->version);
+            break;
+        case COL_SIZE:
+            g_value_set_uint (value, (guint) pc_pkg->filesize);
+            break;
+        case COL_REMOVE:
+            g_value_set_boolean (value, pc_pkg->remove);
+            break;
+        case COL_RECOMM:
+            g_value_set_int (value, pc_pkg->recomm);
+            break;
+        case COL_REASON:
+            g_value_set_int (value, pc_pkg->reason);
+            break;
+        case COL_NB_OLD_VER:
+            g_value_set_int (value, pc_pkg->nb_old_ver);
+            break;
+        case COL_NB_OLD_VER_TOTAL:
+            g_value_set_int (value, pc_pkg->nb_old_ver_total);
+            break;
+    }
+}
+
+static gboolean
+pc_list_model_iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+    pc_pkg_t *pc_pkg = iter->user_data;
+
+    return set_iter_nth (PC_LIST_MODEL (tree_model), iter, (gint) pc_pkg->row + 1);
+}
+
+static gboolean
+pc_list_model_iter_previous (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+    pc_pkg_t *pc_pkg = iter->user_data;
+
+    return set_iter_nth (PC_LIST_MODEL (tree_model), iter, (gint) pc_pkg->row - 1);
+}
+
+static gboolean
+pc_list_model_iter_children (GtkTreeModel *tree_model, GtkTreeIter *iter,
+                             GtkTreeIter *parent)
+{
+    if (parent)
+    {
+        iter->stamp = 0;
+        return FALSE;
+    }
+    return set_iter_nth (PC_LIST_MODEL (tree_model), iter, 0);
+}
+
+static gboolean
+pc_list_model_iter_has_child (GtkTreeModel *tree_model _UNUSED_,
+                              GtkTreeIter *iter _UNUSED_)
+{
+    return FALSE;
+}
+
+static gint
+pc_list_model_iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+    if (iter)
+        return 0;
+    return (gint) PC_LIST_MODEL (tree_model)->rows->len;
+}
+
+static gboolean
+pc_list_model_iter_nth_child (GtkTreeModel *tree_model, GtkTreeIter *iter,
+                              GtkTreeIter *parent, gint n)
+{
+    if (parent)
+    {
+        iter->stamp = 0;
+        return FALSE;
+    }
+    return set_iter_nth (PC_LIST_MODEL (tree_model), iter, n);
+}
+
+static gboolean
+pc_list_model_iter_parent (GtkTreeModel *tree_model _UNUSED_, GtkTreeIter *iter,
+                           GtkTreeIter *child _UNUSED_)
+{
+    iter->stamp = 0;
+    return FALSE;
+}
+
+static void
+pc_list_model_tree_model_init (GtkTreeModelIface *iface)
+{
+    iface->get_flags        = pc_list_model_get_flags;
+    iface->get_n_columns    = pc_list_model_get_n_columns;
+    iface->get_column_type  = pc_list_model_get_column_type;
+    iface->get_iter         = pc_list_model_get_iter;
+    iface->get_path         = pc_list_model_get_path;
+    iface->get_value        = pc_list_model_get_value;
+    iface->iter_next        = pc_list_model_iter_next;
+    iface->iter_previous    = pc_list_model_iter_previous;
+    iface->iter_children    = pc_list_model_iter_children;
+    iface->iter_has_child   = pc_list_model_iter_has_child;
+    iface->iter_n_children  = pc_list_model_iter_n_children;
+    iface->iter_nth_child   = pc_list_model_iter_nth_child;
+    iface->iter_parent      = pc_list_model_iter_parent;
+}
+
+/* sorting */
+
+#define CMP(a, b)   (((a) < (b)) ? -1 : ((a) > (b)) ? 1 : 0)
+
+/* same as what GtkListStore does by default, only without using GValues */
+static gint
+compare_column (gint column, pc_pkg_t *pc_pkg1, pc_pkg_t *pc_pkg2)
+{
+    switch (column)
+    {
+        case COL_PACKAGE:
+            return g_utf8_collate (pc_pkg1->name, pc_pkg2->name);
+        case COL_VERSION:
+            return g_utf8_collate (pc_pkg1->version, pc_pkg2->version);
+        case COL_SIZE:
+            return CMP ((guint) pc_pkg1->filesize, (guint) pc_pkg2->filesize);
+        case COL_REMOVE:
+            return CMP (!!pc_pkg1->remove, !!pc_pkg2->remove);
+        case COL_RECOMM:
+            return CMP (pc_pkg1->recomm, pc_pkg2->recomm);
+        case COL_REASON:
+            return CMP (pc_pkg1->reason, pc_pkg2->reason);
+        case COL_NB_OLD_VER:
+            return CMP (pc_pkg1->nb_old_ver, pc_pkg2->nb_old_ver);
+        case COL_NB_OLD_VER_TOTAL:
+            return CMP (pc_pkg1->nb_old_ver_total, pc_pkg2->nb_old_ver_total);
+        default:
+            return 0;
+    }
+}
+
+static gint
+compare_rows (PcListModel *model, pc_pkg_t *pc_pkg1, pc_pkg_t *pc_pkg2)
+{
+    GtkTreeIterCompareFunc func;
+    gpointer data;
+    gint ret;
+
+    if (model->sort_col == GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+    {
+        func = model->default_sort_func;
+        data = model->default_sort_data;
+    }
+    else
+    {
+        func = model->sort_func[model->sort_col];
+        data = model->sort_data[model->sort_col];
+    }
+
+    if (func)
+    {
+        GtkTreeIter iter1, iter2;
+
+        set_iter (model, &iter1, pc_pkg1);
+        set_iter (model, &iter2, pc_pkg2);
+        ret = func (GTK_TREE_MODEL (model), &iter1, &iter2, data);
+    }
+    else
+        ret = compare_column (model->sort_col, pc_pkg1, pc_pkg2);
+
+    return (model->sort_order == GTK_SORT_DESCENDING) ? -ret : ret;
+}
+
+static gint
+compare_rows_ptr (pc_pkg_t **pc_pkg1, pc_pkg_t **pc_pkg2, PcListModel *model)
+{
+    return compare_rows (model, *pc_pkg1, *pc_pkg2);
+}
+
+static gboolean
+is_sorted (PcListModel *model)
+{
+    if (model->sort_col == GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID)
+        return FALSE;
+    if (model->sort_col == GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+        return model->default_sort_func != NULL;
+    return TRUE;
+}
+
+static void
+sort (PcListModel *model)
+{
+    gint *new_order;
+    GtkTreePath *path;
+    guint i;
+
+    if (!is_sorted (model) || model->rows->len <= 1)
+        return;
+
+    g_ptr_array_sort_with_data (model->rows, (GCompareDataFunc) compare_rows_ptr,
+            model);
+
+    /* new_order[newpos] = oldpos */
+    new_order = g_new (gint, model->rows->len);
+    for (i = 0; i < model->rows->len; ++i)
+    {
+        new_order[i] = (gint) ROW (model, i)->row;
+        ROW (model, i)->row = i;
+    }
+
+    path = gtk_tree_path_new ();
+    gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model), path, NULL, new_order);
+    gtk_tree_path_free (path);
+    g_free (new_order);
+}
+
+/* moves the row of pc_pkg to where it belongs, if its sort value changed. All
+ * other rows are sorted, so we look for its new place with a binary search */
+static void
+resort_row (PcListModel *model, pc_pkg_t *pc_pkg)
+{
+    guint old = pc_pkg->row;
+    guint new = old;
+    guint i, first, last;
+    gint *new_order;
+    GtkTreePath *path;
+
+    if (!is_sorted (model))
+        return;
+
+    if (old > 0 && compare_rows (model, ROW (model, old - 1), pc_pkg) > 0)
+    {
+        /* first row before it that goes after it */
+        first = 0;
+        last = old - 1;
+        while (first < last)
+        {
+            i = first + (last - first) / 2;
+            if (compare_rows (model, ROW (model, i), pc_pkg) > 0)
+                last = i;
+            else
+                first = i + 1;
+        }
+        new = first;
+    }
+    else if (old + 1 < model->rows->len
+            && compare_rows (model, pc_pkg, ROW (model, old + 1)) > 0)
+    {
+        /* last row after it that goes before it */
+        first = old + 1;
+        last = model->rows->len - 1;
+        while (first < last)
+        {
+            i = first + (last - first + 1) / 2;
+            if (compare_rows (model, pc_pkg, ROW (model, i)) > 0)
+                first = i;
+            else
+                last = i - 1;
+        }
+        new = first;
+    }
+    if (new == old)
+        return;
+
+    g_ptr_array_remove_index (model->rows, old);
+    g_ptr_array_insert (model->rows, (gint) new, pc_pkg);
+
+    first = MIN (old, new);
+    last = MAX (old, new);
+    new_order = g_new (gint, model->rows->len);
+    for (i = 0; i < model->rows->len; ++i)
+        new_order[i] = (gint) i;
+    for (i = first; i <= last; ++i)
+    {
+        new_order[i] = (gint) ROW (model, i)->row;
+        ROW (model, i)->row = i;
+    }
+
+    path = gtk_tree_path_new ();
+    gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model), path, NULL, new_order);
+    gtk_tree_path_free (path);
+    g_free (new_order);
+}
+
+/* rows before first are sorted: sorts the ones from first on, and merges them
+ * in, which is much faster than sorting everything when there are only few of
+ * them */
+static void
+merge_rows (PcListModel *model, guint first)
+{
+    pc_pkg_t **rows = (pc_pkg_t **) model->rows->pdata;
+    pc_pkg_t **merged;
+    gint *new_order;
+    GtkTreePath *path;
+    guint len = model->rows->len;
+    guint i, j, k;
+    gboolean moved = FALSE;
+
+    if (!is_sorted (model) || first >= len)
+        return;
+
+    g_qsort_with_data (rows + first, (gint) (len - first), sizeof (gpointer),
+            (GCompareDataFunc) compare_rows_ptr, model);
+
+    merged = g_new (pc_pkg_t *, len);
+    for (i = 0, j = first, k = 0; k < len; ++k)
+    {
+        if (j == len || (i < first && compare_rows (model, rows[i], rows[j]) <= 0))
+            merged[k] = rows[i++];
+        else
+            merged[k] = rows[j++];
+    }
+
+    /* new_order[newpos] = oldpos */
+    new_order = g_new (gint, len);
+    for (k = 0; k < len; ++k)
+    {
+        new_order[k] = (gint) merged[k]->row;
+        if (merged[k]->row != k)
+            moved = TRUE;
+        merged[k]->row = k;
+    }
+    memcpy (rows, merged, len * sizeof (gpointer));
+    g_free (merged);
+
+    if (moved)
+    {
+        path = gtk_tree_path_new ();
+        gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model), path, NULL,
+                new_order);
+        gtk_tree_path_free (path);
+    }
+    g_free (new_order);
+}
+
+/* GtkTreeSortable */
+
+static gboolean
+pc_list_model_get_sort_column_id (GtkTreeSortable *sortable, gint *sort_column_id,
+                                  GtkSortType *order)
+{
+    PcListModel *model = PC_LIST_MODEL (sortable);
+
+    if (sort_column_id)
+        *sort_column_id = model->sort_col;
+    if (order)
+        *order = model->sort_order;
+    return model->sort_col != GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID
+        && model->sort_col != GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+}
+
+static void
+pc_list_model_set_sort_column_id (GtkTreeSortable *sortable, gint sort_column_id,
+                                  GtkSortType order)
+{
+    PcListModel *model = PC_LIST_MODEL (sortable);
+
+    if (model->sort_col == sort_column_id && model->sort_order == order)
+        return;
+
+    model->sort_col = sort_column_id;
+    model->sort_order = order;
+    gtk_tree_sortable_sort_column_changed (sortable);
+    sort (model);
+}
+
+static void
+pc_list_model_set_sort_func (GtkTreeSortable *sortable, gint sort_column_id,
+                             GtkTreeIterCompareFunc sort_func, gpointer user_data,
+                             GDestroyNotify destroy)
+{
+    PcListModel *model = PC_LIST_MODEL (sortable);
+
+    g_return_if_fail (sort_column_id >= 0 && sort_column_id < COL_NB);
+
+    if (model->sort_destroy[sort_column_id])
+        model->sort_destroy[sort_column_id] (model->sort_data[sort_column_id]);
+    model->sort_func[sort_column_id] = sort_func;
+    model->sort_data[sort_column_id] = user_data;
+    model->sort_destroy[sort_column_id] = destroy;
+
+    if (model->sort_col == sort_column_id)
+        sort (model);
+}
+
+static void
+pc_list_model_set_default_sort_func (GtkTreeSortable *sortable,
+                                     GtkTreeIterCompareFunc sort_func,
+                                     gpointer user_data, GDestroyNotify destroy)
+{
+    PcListModel *model = PC_LIST_MODEL (sortable);
+
+    if (model->default_sort_destroy)
+        model->default_sort_destroy (model->default_sort_data);
+    model->default_sort_func = sort_func;
+    model->default_sort_data = user_data;
+    model->default_sort_destroy = destroy;
+
+    if (model->sort_col == GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+        sort (model);
+}
+
+static gboolean
+pc_list_model_has_default_sort_func (GtkTreeSortable *sortable)
+{
+    return PC_LIST_MODEL (sortable)->default_sort_func != NULL;
+}
+
+static void
+pc_list_model_tree_sortable_init (GtkTreeSortableIface *iface)
+{
+    iface->get_sort_column_id       = pc_list_model_get_sort_column_id;
+    iface->set_sort_column_id       = pc_list_model_set_sort_column_id;
+    iface->set_sort_func            = pc_list_model_set_sort_func;
+    iface->set_default_sort_func    = pc_list_model_set_default_sort_func;
+    iface->has_default_sort_func    = pc_list_model_has_default_sort_func;
+}
+
+/* GObject */
+
+static void
+pc_list_model_finalize (GObject *object)
+{
+    PcListModel *model = PC_LIST_MODEL (object);
+    gint i;
+
+    for (i = 0; i < COL_NB; ++i)
+        if (model->sort_destroy[i])
+            model->sort_destroy[i] (model->sort_data[i]);
+    if (model->default_sort_destroy)
+        model->default_sort_destroy (model->default_sort_data);
+    g_ptr_array_unref (model->rows);
+    g_ptr_array_unref (model->changed);
+
+    G_OBJECT_CLASS (pc_list_model_parent_class)->finalize (object);
+}
+
+static void
+pc_list_model_class_init (PcListModelClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->finalize = pc_list_model_finalize;
+}
+
+static void
+pc_list_model_init (PcListModel *model)
+{
+    model->rows = g_ptr_array_new ();
+    model->changed = g_ptr_array_new ();
+    model->stamp = g_random_int ();
+    model->sort_col = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+    model->sort_order = GTK_SORT_ASCENDING;
+}
+
+/* API */
+
+PcListModel *
+pc_list_model_new (void)
+{
+    return g_object_new (PC_TYPE_LIST_MODEL, NULL);
+}
+
+void
+pc_list_model_clear (PcListModel *model)
+{
+    GtkTreePath *path;
+
+    /* deleting from the end, so there's no need to update indices */
+    path = gtk_tree_path_new_from_indices ((gint) model->rows->len, -1);
+    while (model->rows->len > 0)
+    {
+        gtk_tree_path_prev (path);
+        g_ptr_array_set_size (model->rows, (gint) model->rows->len - 1);
+        gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+    }
+    gtk_tree_path_free (path);
+    g_ptr_array_set_size (model->changed, 0);
+    ++model->stamp;
+}
+
+/* sets all packages as rows of the model, replacing any previous ones. No
+ * signal is emitted, so rows are all set & sorted in one go: the model must not
+ * be used (e.g. by a view) at the time, i.e. the view should be given the
+ * model once loaded. */
+void
+pc_list_model_load_rows (PcListModel *model, GPtrArray *packages)
+{
+    guint i;
+
+    ++model->stamp;
+    g_ptr_array_set_size (model->changed, 0);
+    g_ptr_array_set_size (model->rows, (gint) packages->len);
+    if (packages->len > 0)
+        memcpy (model->rows->pdata, packages->pdata,
+                packages->len * sizeof (gpointer));
+    if (is_sorted (model))
+        g_ptr_array_sort_with_data (model->rows,
+                (GCompareDataFunc) compare_rows_ptr, model);
+    for (i = 0; i < model->rows->len; ++i)
+        ROW (model, i)->row = i;
+}
+
+/* to be called after pc_pkg was changed */
+void
+pc_list_model_row_changed (PcListModel *model, pc_pkg_t *pc_pkg)
+{
+    GtkTreePath *path;
+    GtkTreeIter iter;
+
+    set_iter (model, &iter, pc_pkg);
+    path = gtk_tree_path_new_from_indices ((gint) pc_pkg->row, -1);
+    gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+    gtk_tree_path_free (path);
+
+    if (model->frozen > 0)
+        g_ptr_array_add (model->changed, pc_pkg);
+    else
+        resort_row (model, pc_pkg);
+}
+
+/* to change many rows at once: until thawed, rows don't move when changed.
+ * Rows must not be added or moved meanwhile (removing is fine) */
+void
+pc_list_model_freeze_sort (PcListModel *model)
+{
+    ++model->frozen;
+}
+
+/* moves all rows changed while frozen to where they belong: they're taken out
+ * and merged back in, in one go */
+void
+pc_list_model_thaw_sort (PcListModel *model)
+{
+    pc_pkg_t **rows = (pc_pkg_t **) model->rows->pdata;
+    pc_pkg_t **moved;
+    gboolean *changed;
+    guint len = model->rows->len;
+    guint i, j, k;
+
+    g_return_if_fail (model->frozen > 0);
+    if (--model->frozen > 0 || model->changed->len == 0)
+        return;
+
+    if (model->changed->len == 1)
+    {
+        resort_row (model, g_ptr_array_index (model->changed, 0));
+        g_ptr_array_set_size (model->changed, 0);
+        return;
+    }
+    if (!is_sorted (model))
+    {
+        g_ptr_array_set_size (model->changed, 0);
+        return;
+    }
+
+    /* rows can have changed more than once */
+    changed = g_new0 (gboolean, len);
+    for (i = 0; i < model->changed->len; ++i)
+        changed[((pc_pkg_t *) g_ptr_array_index (model->changed, i))->row] = TRUE;
+    g_ptr_array_set_size (model->changed, 0);
+
+    /* other rows are still sorted; moved ones go at the end for merge_rows.
+     * Their row isn't updated, so it can tell where they were */
+    moved = g_new (pc_pkg_t *, len);
+    for (i = j = k = 0; i < len; ++i)
+    {
+        if (changed[i])
+            moved[k++] = rows[i];
+        else
+            rows[j++] = rows[i];
+    }
+    memcpy (rows + j, moved, k * sizeof (gpointer));
+    g_free (moved);
+    g_free (changed);
+
+    merge_rows (model, j);
+}
+
+/* adds packages as new rows, where they belong if the model is sorted, else at
+ * the end. Meant to add rows in batches while loading: the view can be used
+ * (and sorted) meanwhile, unlike with pc_list_model_load_rows */
+void
+pc_list_model_append_rows (PcListModel *model, GPtrArray *packages)
+{
+    GtkTreePath *path;
+    GtkTreeIter iter;
+    guint first = model->rows->len;
+    guint i;
+
+    for (i = 0; i < packages->len; ++i)
+    {
+        pc_pkg_t *pc_pkg = g_ptr_array_index (packages, i);
+
+        pc_pkg->row = model->rows->len;
+        g_ptr_array_add (model->rows, pc_pkg);
+        set_iter (model, &iter, pc_pkg);
+        path = gtk_tree_path_new_from_indices ((gint) pc_pkg->row, -1);
+        gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+        gtk_tree_path_free (path);
+    }
+
+    merge_rows (model, first);
+}
+
+/* adds pc_pkg as a new row, where it belongs if the model is sorted, else at
+ * the end */
+void
+pc_list_model_insert (PcListModel *model, pc_pkg_t *pc_pkg)
+{
+    GtkTreePath *path;
+    GtkTreeIter iter;
+    guint i, first, last;
+
+    first = 0;
+    last = model->rows->len;
+    if (is_sorted (model))
+        while (first < last)
+        {
+            i = first + (last - first) / 2;
+            if (compare_rows (model, ROW (model, i), pc_pkg) > 0)
+                last = i;
+            else
+                first = i + 1;
+        }
+    else
+        first = last;
+
+    g_ptr_array_insert (model->rows, (gint) first, pc_pkg);
+    for (i = first; i < model->rows->len; ++i)
+        ROW (model, i)->row = i;
+
+    set_iter (model, &iter, pc_pkg);
+    path = gtk_tree_path_new_from_indices ((gint) first, -1);
+    gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+    gtk_tree_path_free (path);
+}
+
+void
+pc_list_model_remove (PcListModel *model, pc_pkg_t *pc_pkg)
+{
+    GtkTreePath *path;
+    guint i;
+
+    /* in case it was changed while frozen */
+    while (g_ptr_array_remove_fast (model->changed, pc_pkg))
+        ;
+
+    path = gtk_tree_path_new_from_indices ((gint) pc_pkg->row, -1);
+    g_ptr_array_remove_index (model->rows, pc_pkg->row);
+    for (i = pc_pkg->row; i < model->rows->len; ++i)
+        ROW (model, i)->row = i;
+    gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+    gtk_tree_path_free (path);
+}
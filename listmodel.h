@@ -0,0 +1,55 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * listmodel.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef _PKGCLIP_LISTMODEL_H
+#define _PKGCLIP_LISTMODEL_H
+
+#include "pkgclip.h"
+
+/* A GtkTreeModel (& GtkTreeSortable) for the list of packages, reading
+ * columns straight from the pc_pkg_t records. Rows aren't owned by the model,
+ * each record has its index in the model (row), and iters simply point to
+ * the record.
+ */
+
+#define PC_TYPE_LIST_MODEL          (pc_list_model_get_type ())
+#define PC_LIST_MODEL(obj)          (G_TYPE_CHECK_INSTANCE_CAST ((obj), \
+                                        PC_TYPE_LIST_MODEL, PcListModel))
+#define PC_IS_LIST_MODEL(obj)       (G_TYPE_CHECK_INSTANCE_TYPE ((obj), \
+                                        PC_TYPE_LIST_MODEL))
+
+typedef struct _PcListModelClass {
+    GObjectClass parent_class;
+} PcListModelClass;
+
+GType pc_list_model_get_type (void);
+PcListModel * pc_list_model_new (void);
+void pc_list_model_load_rows (PcListModel *model, GPtrArray *packages);
+void pc_list_model_clear (PcListModel *model);
+void pc_list_model_row_changed (PcListModel *model, pc_pkg_t *pc_pkg);
+void pc_list_model_freeze_sort (PcListModel *model);
+void pc_list_model_thaw_sort (PcListModel *model);
+void pc_list_model_append_rows (PcListModel *model, GPtrArray *packages);
+void pc_list_model_insert (PcListModel *model, pc_pkg_t *pc_pkg);
+void pc_list_model_remove (PcListModel *model, pc_pkg_t *pc_pkg);
+
+#endif /* _PKGCLIP_LISTMODEL_H */
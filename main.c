@@ -29,20 +29,28 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 
+/* gio - to pass fds over dbus */
+#include <gio/gunixfdlist.h>
+
 /* pkgclip */
 #include "pkgclip.h"
 #include "util.h"
+#include "dialog.h"
+#include "mdcache.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "listmodel.h"
+#include "scan.h"
+#include "cli.h"
 #include "xpm.h"
 
-#define FREEPCPKGLIST(p)    do {                                \
-    alpm_list_free_inner (p, (alpm_list_fn_free) free_pc_pkg);  \
-    alpm_list_free (p);                                         \
-    p = NULL;                                                   \
-} while(0)
-
 static gboolean post_reload_list (pkgclip_t *pkgclip);
+static void reload_list (pkgclip_t *pkgclip);
 
 static const char *recomm_label[] = {
     "Keep",
@@ -59,14 +67,6 @@ static const char *reason_label[] = {
     "Package not installed on system (any version)"
 };
 
-static void
-free_pc_pkg (pc_pkg_t *pc_pkg)
-{
-    free (pc_pkg->file);
-    alpm_pkg_free (pc_pkg->pkg);
-    free (pc_pkg);
-}
-
 static void
 quit (pkgclip_t *pkgclip)
 {
@@ -76,7 +76,7 @@ quit (pkgclip_t *pkgclip)
         pkgclip->proxy = NULL;
     }
 
-    if (!pkgclip->is_loading)
+    if (!pkgclip->is_loading && !pkgclip->is_syncing)
         gtk_main_quit ();
     else
         pkgclip->abort = TRUE;
@@ -102,9 +102,14 @@ rend_recomm (GtkTreeViewColumn *column _UNUSED_, GtkCellRenderer *renderer,
     GtkTreeModel *store, GtkTreeIter *iter, gpointer data _UNUSED_)
 {
     recomm_t recomm;
+    pc_pkg_t *pc_pkg;
 
-    gtk_tree_model_get (store, iter, COL_RECOMM, &recomm, -1);
-    g_object_set (renderer, "text", recomm_label[recomm], NULL);
+    gtk_tree_model_get (store, iter, COL_PC_PKG, &pc_pkg, COL_RECOMM, &recomm, -1);
+    /* still loading */
+    if (!pc_pkg->classified)
+        g_object_set (renderer, "text", NULL, NULL);
+    else
+        g_object_set (renderer, "text", recomm_label[recomm], NULL);
 }
 
 static void
@@ -113,9 +118,12 @@ rend_reason (GtkTreeViewColumn *column _UNUSED_, GtkCellRenderer *renderer,
 {
     reason_t reason;
     int nb_old_ver, nb_old_ver_total;
+    pc_pkg_t *pc_pkg;
 
-    gtk_tree_model_get (store, iter, COL_REASON, &reason, -1);
-    if (reason == REASON_OLDER_VERSION)
+    gtk_tree_model_get (store, iter, COL_PC_PKG, &pc_pkg, COL_REASON, &reason, -1);
+    if (!pc_pkg->classified)
+        g_object_set (renderer, "text", NULL, NULL);
+    else if (reason == REASON_OLDER_VERSION)
     {
         char buf[255];
         gtk_tree_model_get (store, iter,
@@ -139,38 +147,22 @@ rend_reason (GtkTreeViewColumn *column _UNUSED_, GtkCellRenderer *renderer,
         g_object_set (renderer, "text", reason_label[reason], NULL);
 }
 
-static int
-init_alpm (pkgclip_t *pkgclip)
+static void
+rend_error_count (GtkTreeViewColumn *column _UNUSED_, GtkCellRenderer *renderer,
+    GtkTreeModel *store, GtkTreeIter *iter, gpointer data _UNUSED_)
 {
-    enum _alpm_errno_t err;
+    int count;
+    char buf[12];
 
-    pkgclip->handle = alpm_initialize(pkgclip->rootpath, pkgclip->dbpath, &err);
-    if (!pkgclip->handle)
+    /* only set on groups */
+    gtk_tree_model_get (store, iter, 1, &count, -1);
+    if (count > 0)
     {
-        show_error ("Failed to initialize ALPM library", alpm_strerror (err),
-                pkgclip);
-        return -1;
+        snprintf (buf, 12, "%d", count);
+        g_object_set (renderer, "text", buf, NULL);
     }
-
-    alpm_list_t *i;
-    for (i = pkgclip->cachedirs; i; i = alpm_list_next (i))
-        alpm_option_add_cachedir (pkgclip->handle, i->data);
-
-    return 0;
-}
-
-static int
-pc_pkg_cmp (const pc_pkg_t *pkg1, const pc_pkg_t *pkg2)
-{
-    int ret;
-
-    ret = strcmp (pkg1->name, pkg2->name);
-    if (ret == 0)
-        /* same package, compare version */
-        /* when ASC, we want pkg-2.0 first, then pkg-1.0 -- that way the most
-         * recent versions are first */
-        ret = 0 - alpm_pkg_vercmp (pkg1->version, pkg2->version);
-    return ret;
+    else
+        g_object_set (renderer, "text", NULL, NULL);
 }
 
 static void
@@ -208,16 +200,33 @@ clear_packages (gboolean full, pkgclip_t *pkgclip)
 {
     pkgclip->marked_packages = 0;
     pkgclip->marked_size = 0;
-    gtk_list_store_clear (pkgclip->store);
+    pc_list_model_clear (pkgclip->store);
     if (full)
     {
-        FREEPCPKGLIST (pkgclip->packages);
+        g_hash_table_remove_all (pkgclip->files);
+        g_ptr_array_set_size (pkgclip->packages, 0);
+        /* all records of the previous scan go at once */
+        arena_free (pkgclip->arena);
+        pkgclip->arena = arena_new ();
         pkgclip->total_packages = 0;
         pkgclip->total_size = 0;
     }
     update_label (pkgclip);
 }
 
+static void
+load_list_model (pkgclip_t *pkgclip)
+{
+    /* detach the model from the list while loading all rows at once, so
+     * there's no signal or sorting done for each row */
+    g_object_ref (pkgclip->store);
+    gtk_tree_view_set_model (GTK_TREE_VIEW (pkgclip->list), NULL);
+    pc_list_model_load_rows (pkgclip->store, pkgclip->packages);
+    gtk_tree_view_set_model (GTK_TREE_VIEW (pkgclip->list),
+            GTK_TREE_MODEL (pkgclip->store));
+    g_object_unref (pkgclip->store);
+}
+
 static void
 refresh_list (gboolean from_reloading, pkgclip_t *pkgclip)
 {
@@ -235,150 +244,421 @@ refresh_list (gboolean from_reloading, pkgclip_t *pkgclip)
 
     gtk_label_set_text (GTK_LABEL (pkgclip->label), "Refreshing list; Please wait...");
 
-    GtkTreeIter iter;
-    alpm_list_t *i;
-    alpm_db_t *db_local = alpm_get_localdb (pkgclip->handle);
-    const char *last_pkg = NULL;
-    const char *inst_ver = NULL;
-    int old_ver, nb_old_ver;
-    char *pkgrel = NULL;
-    int is_installed = 0;
+    classify_packages (NULL, NULL, pkgclip);
+    load_list_model (pkgclip);
 
-    for (i = pkgclip->packages; i; i = alpm_list_next (i))
+    if (!from_reloading)
     {
-        pc_pkg_t *pc_pkg = i->data;
+        pkgclip->is_loading = FALSE;
+        set_locked (FALSE, pkgclip);
+        update_label (pkgclip);
+    }
+    if (pkgclip->show_pkg_info && pkgclip->handler_pkg_info)
+        g_signal_handler_unblock (pkgclip->list, pkgclip->handler_pkg_info);
+}
 
-        /* is this a new package? */
-        if (NULL == last_pkg || strcmp (last_pkg, pc_pkg->name) != 0)
-        {
-            last_pkg = pc_pkg->name;
-            old_ver = 0;
-            nb_old_ver = pkgclip->nb_old_ver;
+static void
+pkg_changed (pc_pkg_t *pc_pkg, pkgclip_t *pkgclip)
+{
+    pc_list_model_row_changed (pkgclip->store, pc_pkg);
+}
 
-            /* is it installed? */
-            alpm_pkg_t *pkg = alpm_db_get_pkg (db_local, pc_pkg->name);
-            if (NULL != pkg)
-            {
-                is_installed = 1;
-                inst_ver = alpm_pkg_get_version (pkg);
-                pkgrel = strrchr(inst_ver, '-');
-            }
-            else
-            {
-                is_installed = 0;
-                inst_ver = NULL;
-                pkgrel = NULL;
-            }
-        }
+/* reclassifies all packages in place, e.g. after preferences were changed:
+ * rows are updated (only if needed) instead of rebuilding the whole list */
+static void
+reclassify_list (pkgclip_t *pkgclip)
+{
+    /* all packages are classified once loaded, with current preferences */
+    if (pkgclip->is_loading)
+        return;
 
-        if (is_installed > 0)
-        {
-            int cmp = alpm_pkg_vercmp (pc_pkg->version, inst_ver);
-            if (cmp == 0)
-                /* installed version */
-                pc_pkg->reason = REASON_INSTALLED;
-            else if (cmp < 0)
-            {
-                /* older version, we only keep a certain amount */
-                ++old_ver;
-                /* not yet reached? */
-                if (old_ver <= nb_old_ver)
-                {
-                    /* but: should we check if it's not just an old pkgrel? */
-                    if (pkgclip->old_pkgrel)
-                    {
-                        char *s = strrchr(pc_pkg->version, '-');
-                        if (s)
-                        {
-                            /* "remove" the pkgrel from version */
-                            *s = '\0';
-                            /* "remove" the pkgrel from installed version */
-                            if (pkgrel)
-                                *pkgrel = '\0';
-                            /* are they the same? */
-                            if (alpm_pkg_vercmp (pc_pkg->version, inst_ver) == 0)
-                            {
-                                /* same version, older pkgrel */
-                                --old_ver;
-                                pc_pkg->reason = REASON_OLDER_PKGREL;
-                            }
-                            else
-                                /* older version */
-                                pc_pkg->reason = REASON_OLDER_VERSION;
-                            /* restore */
-                            *s = '-';
-                            if (pkgrel)
-                                *pkgrel = '-';
-                        }
-                        else
-                            /* no pkgrel, so it is an older version */
-                            pc_pkg->reason = REASON_OLDER_VERSION;
-                    }
-                    else
-                        /* older version */
-                        pc_pkg->reason = REASON_OLDER_VERSION;
-                }
-                else
-                    /* we already have our stock of old versions */
-                    pc_pkg->reason = REASON_ALREADY_OLDER_VERSION;
-            }
-            else
-                /* newer than installed */
-                pc_pkg->reason = REASON_NEWER_THAN_INSTALLED;
-        }
-        else if (NULL != alpm_list_find_str (pkgclip->as_installed, pc_pkg->name))
-        {
-            /* treat as if installed */
-            pc_pkg->reason = REASON_AS_INSTALLED;
-            is_installed = 2;
-            nb_old_ver = pkgclip->nb_old_ver_ai;
-            inst_ver = pc_pkg->version;
-            pkgrel = strrchr(inst_ver, '-');
-        }
+    pc_list_model_freeze_sort (pkgclip->store);
+    classify_packages ((pkg_changed_fn) pkg_changed, pkgclip, pkgclip);
+    pc_list_model_thaw_sort (pkgclip->store);
+    update_label (pkgclip);
+}
+
+/* reclassifies in place all versions of the given package */
+static void
+reclassify_package (const char *name, pkgclip_t *pkgclip)
+{
+    guint first, last;
+
+    if (!find_group (name, &first, &last, pkgclip))
+        return;
+
+    prepare_snapshot (pkgclip);
+    pc_list_model_freeze_sort (pkgclip->store);
+    classify_group (first, last, (pkg_changed_fn) pkg_changed, pkgclip, pkgclip);
+    pc_list_model_thaw_sort (pkgclip->store);
+    update_label (pkgclip);
+}
+
+/* adds a package (not yet classified) to the list & model */
+static void
+add_package (pc_pkg_t *pc_pkg, pkgclip_t *pkgclip)
+{
+    guint first = 0, last = pkgclip->packages->len;
+
+    while (first < last)
+    {
+        guint i = first + (last - first) / 2;
+        if (pc_pkg_cmp (g_ptr_array_index (pkgclip->packages, i), pc_pkg) > 0)
+            last = i;
         else
-            /* no such package (any version) installed */
-            pc_pkg->reason = REASON_PKG_NOT_INSTALLED;
+            first = i + 1;
+    }
+    g_ptr_array_insert (pkgclip->packages, (gint) first, pc_pkg);
+    g_hash_table_insert (pkgclip->files, pc_pkg->file, pc_pkg);
+
+    ++(pkgclip->total_packages);
+    pkgclip->total_size += pc_pkg->filesize;
+    pc_list_model_insert (pkgclip->store, pc_pkg);
+}
+
+/* removes a package from the list & model. Its record remains in the arena,
+ * accounted as dead (see reload_if_wasteful) */
+static void
+drop_package (pc_pkg_t *pc_pkg, pkgclip_t *pkgclip)
+{
+    guint i, last;
+
+    if (!find_group (pc_pkg->name, &i, &last, pkgclip))
+        return;
+    for ( ; i < last; ++i)
+        if (g_ptr_array_index (pkgclip->packages, i) == pc_pkg)
+            break;
+    if (i == last)
+        return;
+
+    --(pkgclip->total_packages);
+    pkgclip->total_size -= pc_pkg->filesize;
+    if (pc_pkg->remove)
+    {
+        --(pkgclip->marked_packages);
+        pkgclip->marked_size -= pc_pkg->filesize;
+    }
+    g_hash_table_remove (pkgclip->files, pc_pkg->file);
+    pc_list_model_remove (pkgclip->store, pc_pkg);
+    g_ptr_array_remove_index (pkgclip->packages, i);
+    arena_release (pkgclip->arena, pc_pkg_size (pc_pkg));
+}
+
+/* records dropped from the list remain in the arena until the next reload;
+ * once they're (at least) that much and half of it, we do a reload to get a
+ * fresh one. Returns TRUE if so */
+#define MAX_DEAD_SIZE       (1024 * 1024)
+
+static gboolean
+reload_if_wasteful (pkgclip_t *pkgclip)
+{
+    gsize dead = arena_get_dead (pkgclip->arena);
+
+    if (dead < MAX_DEAD_SIZE || dead < arena_get_size (pkgclip->arena) / 2)
+        return FALSE;
+    reload_list (pkgclip);
+    return TRUE;
+}
+
+/* how long to wait after a change in a cachedir, to process all changes made
+ * meanwhile at once (ms) */
+#define WATCH_DELAY         250
+
+/* files that changed in the cachedirs, loaded in a worker thread */
+typedef struct _sync_job_t {
+    pkgclip_t   *pkgclip;
+    /* full paths of files to load */
+    GPtrArray   *paths;
+    GPtrArray   *loaded;
+    /* names of packages to reclassify once done */
+    GHashTable  *names;
+} sync_job_t;
+
+static void
+free_sync_job (sync_job_t *job)
+{
+    g_ptr_array_unref (job->paths);
+    g_ptr_array_unref (job->loaded);
+    g_hash_table_unref (job->names);
+    g_free (job);
+}
+
+/* adds the packages loaded, and reclassifies all groups that changed */
+static gboolean
+post_sync_cachedirs (sync_job_t *job)
+{
+    pkgclip_t *pkgclip = job->pkgclip;
+    GHashTableIter iter;
+    const char *name;
+    guint i;
+
+    pkgclip->is_syncing = FALSE;
+    if (pkgclip->abort)
+    {
+        free_sync_job (job);
+        gtk_main_quit ();
+        return FALSE;
+    }
+
+    for (i = 0; i < job->loaded->len; ++i)
+    {
+        pc_pkg_t *pc_pkg = g_ptr_array_index (job->loaded, i);
+
+        add_package (pc_pkg, pkgclip);
+        g_hash_table_add (job->names, g_strdup (pc_pkg->name));
+    }
+
+    g_hash_table_iter_init (&iter, job->names);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL))
+        reclassify_package (name, pkgclip);
+
+    free_sync_job (job);
+    set_locked (FALSE, pkgclip);
+    update_label (pkgclip);
+    reload_if_wasteful (pkgclip);
+    return FALSE;
+}
 
-        /* set recomm */
-        pc_pkg->recomm = pkgclip->recomm[pc_pkg->reason];
+static void
+thread_sync_cachedirs (sync_job_t *job)
+{
+    scan_load_files (job->paths, job->loaded, job->pkgclip);
+    g_idle_add ((GSourceFunc) post_sync_cachedirs, job);
+}
+
+/* brings the list up to date with all files that changed in the cachedirs:
+ * packages are added/removed, and only their groups reclassified. New files
+ * are loaded in a worker thread, with the list locked meanwhile so no reload
+ * (or removal) can happen until they've been added. */
+static gboolean
+sync_cachedirs (pkgclip_t *pkgclip)
+{
+    GHashTableIter iter;
+    const char *path;
+    sync_job_t *job;
+
+    /* loading or removing packages, try again later. (Once loaded, files will
+     * be found as already known.) */
+    if (pkgclip->locked)
+        return TRUE;
+
+    job = g_new (sync_job_t, 1);
+    job->pkgclip = pkgclip;
+    job->paths = g_ptr_array_new_with_free_func (g_free);
+    job->loaded = g_ptr_array_new ();
+    job->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_hash_table_iter_init (&iter, pkgclip->dirty);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &path, NULL))
+    {
+        pc_pkg_t *pc_pkg = g_hash_table_lookup (pkgclip->files, path);
+        struct stat sb;
+        gboolean exists;
 
-        if (pc_pkg->recomm == RECOMM_REMOVE)
+        exists = stat (path, &sb) == 0 && S_ISREG (sb.st_mode);
+        if (pc_pkg && exists && pc_pkg_same_file (pc_pkg, &sb))
+            continue;
+
+        if (pc_pkg)
         {
-            pc_pkg->remove = TRUE;
-            ++(pkgclip->marked_packages);
-            pkgclip->marked_size += pc_pkg->filesize;
+            g_hash_table_add (job->names, g_strdup (pc_pkg->name));
+            drop_package (pc_pkg, pkgclip);
         }
-        else
-            pc_pkg->remove = FALSE;
-
-        gtk_list_store_append (pkgclip->store, &iter);
-        gtk_list_store_set (pkgclip->store, &iter,
-                COL_PC_PKG,             pc_pkg,
-                COL_PACKAGE,            pc_pkg->name,
-                COL_VERSION,            pc_pkg->version,
-                COL_SIZE,               (guint) pc_pkg->filesize,
-                COL_RECOMM,             pc_pkg->recomm,
-                COL_REMOVE,             pc_pkg->remove,
-                COL_REASON,             pc_pkg->reason,
-                COL_NB_OLD_VER,         old_ver,
-                COL_NB_OLD_VER_TOTAL,   nb_old_ver,
-                -1);
+        if (exists)
+            g_ptr_array_add (job->paths, g_strdup (path));
     }
+    /* changes from now on will be processed next time */
+    g_hash_table_remove_all (pkgclip->dirty);
+    pkgclip->dirty_id = 0;
 
-    if (!from_reloading)
+    if (job->paths->len == 0)
     {
-        pkgclip->is_loading = FALSE;
-        set_locked (FALSE, pkgclip);
-        update_label (pkgclip);
+        post_sync_cachedirs (job);
+        return FALSE;
+    }
+
+    /* uses pkgclip->handle, so not from the thread */
+    scan_prepare_load (pkgclip);
+    set_locked (TRUE, pkgclip);
+    pkgclip->is_syncing = TRUE;
+    g_thread_unref (g_thread_new ("sync-cachedirs",
+                (GThreadFunc) thread_sync_cachedirs, job));
+    return FALSE;
+}
+
+static void
+cachedir_changed_cb (GFileMonitor      *monitor,
+                     GFile             *file,
+                     GFile             *other_file,
+                     GFileMonitorEvent  event,
+                     pkgclip_t         *pkgclip)
+{
+    const char *cachedir = g_object_get_data (G_OBJECT (monitor), "cachedir");
+    GFile *files[2] = { file, NULL };
+    int i;
+
+    switch (event)
+    {
+        /* created files are only handled once complete */
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        case G_FILE_MONITOR_EVENT_DELETED:
+        case G_FILE_MONITOR_EVENT_MOVED_IN:
+        case G_FILE_MONITOR_EVENT_MOVED_OUT:
+            break;
+        case G_FILE_MONITOR_EVENT_RENAMED:
+            /* e.g. pacman's .part once downloaded */
+            files[1] = other_file;
+            break;
+        default:
+            return;
+    }
+
+    for (i = 0; i < 2 && files[i]; ++i)
+    {
+        gchar *name = g_file_get_basename (files[i]);
+
+        /* .sig files go with their packages, and .part are being downloaded */
+        if (!g_str_has_suffix (name, ".sig") && !g_str_has_suffix (name, ".part"))
+            /* same path as when scanning, since that's how files are known */
+            g_hash_table_add (pkgclip->dirty, g_strconcat (cachedir, name, NULL));
+        g_free (name);
+    }
+
+    /* changes are processed in batches, e.g. for pacman downloading a bunch
+     * of packages */
+    if (pkgclip->dirty_id == 0 && g_hash_table_size (pkgclip->dirty) > 0)
+        pkgclip->dirty_id = g_timeout_add (WATCH_DELAY,
+                (GSourceFunc) sync_cachedirs, pkgclip);
+}
+
+/* how long to wait after a change in the local db, e.g. for pacman to be done
+ * installing/removing packages (ms) */
+#define DB_DELAY            1000
+
+/* once the local db (or pacman.conf) changed, reclassifies all packages (or
+ * reloads them) */
+static gboolean
+refresh_db (pkgclip_t *pkgclip)
+{
+    char lck[PATH_MAX];
+
+    /* loading/removing packages, or pacman is still running: try again later */
+    snprintf (lck, PATH_MAX, "%s/db.lck", pkgclip->dbpath);
+    if (pkgclip->locked || access (lck, F_OK) == 0)
+        return TRUE;
+
+    pkgclip->db_id = 0;
+    switch (refresh_alpm (pkgclip))
+    {
+        case REFRESH_CONF:
+            reload_list (pkgclip);
+            break;
+        case REFRESH_DB:
+            reclassify_list (pkgclip);
+            break;
+        case REFRESH_NONE:
+            break;
+    }
+    return FALSE;
+}
+
+static void
+localdb_changed_cb (GFileMonitor      *monitor _UNUSED_,
+                    GFile             *file _UNUSED_,
+                    GFile             *other_file _UNUSED_,
+                    GFileMonitorEvent  event _UNUSED_,
+                    pkgclip_t         *pkgclip)
+{
+    if (pkgclip->db_id == 0)
+        pkgclip->db_id = g_timeout_add (DB_DELAY, (GSourceFunc) refresh_db,
+                pkgclip);
+}
+
+static void
+watch_cachedirs (pkgclip_t *pkgclip)
+{
+    char path[PATH_MAX];
+    alpm_list_t *i;
+    GFile *dir;
+
+    if (!pkgclip->watch_cache || pkgclip->monitors || !pkgclip->handle)
+        return;
+
+    pkgclip->monitors = g_ptr_array_new_with_free_func (g_object_unref);
+    pkgclip->dirty = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    for (i = alpm_option_get_cachedirs (pkgclip->handle); i; i = alpm_list_next (i))
+    {
+        GFileMonitor *monitor;
+
+        dir = g_file_new_for_path (i->data);
+        monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_WATCH_MOVES,
+                NULL, NULL);
+        g_object_unref (dir);
+        /* if it can't be accessed, it was/will be reported when scanning */
+        if (!monitor)
+            continue;
+
+        /* not the one from ALPM, as the handle might be reset meanwhile */
+        g_object_set_data_full (G_OBJECT (monitor), "cachedir",
+                g_strdup (i->data), g_free);
+        g_signal_connect (G_OBJECT (monitor), "changed",
+                G_CALLBACK (cachedir_changed_cb), (gpointer) pkgclip);
+        g_ptr_array_add (pkgclip->monitors, monitor);
+    }
+
+    snprintf (path, PATH_MAX, "%s/local", pkgclip->dbpath);
+    dir = g_file_new_for_path (path);
+    pkgclip->db_monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE,
+            NULL, NULL);
+    g_object_unref (dir);
+    if (pkgclip->db_monitor)
+        g_signal_connect (G_OBJECT (pkgclip->db_monitor), "changed",
+                G_CALLBACK (localdb_changed_cb), (gpointer) pkgclip);
+}
+
+static void
+unwatch_cachedirs (pkgclip_t *pkgclip)
+{
+    guint i;
+
+    if (!pkgclip->monitors)
+        return;
+
+    for (i = 0; i < pkgclip->monitors->len; ++i)
+    {
+        GFileMonitor *monitor = g_ptr_array_index (pkgclip->monitors, i);
+
+        g_signal_handlers_disconnect_by_data (monitor, pkgclip);
+        g_file_monitor_cancel (monitor);
+    }
+    g_ptr_array_unref (pkgclip->monitors);
+    pkgclip->monitors = NULL;
+
+    if (pkgclip->dirty_id > 0)
+    {
+        g_source_remove (pkgclip->dirty_id);
+        pkgclip->dirty_id = 0;
+    }
+    g_hash_table_unref (pkgclip->dirty);
+    pkgclip->dirty = NULL;
+
+    if (pkgclip->db_monitor)
+    {
+        g_signal_handlers_disconnect_by_data (pkgclip->db_monitor, pkgclip);
+        g_file_monitor_cancel (pkgclip->db_monitor);
+        g_object_unref (pkgclip->db_monitor);
+        pkgclip->db_monitor = NULL;
+    }
+    if (pkgclip->db_id > 0)
+    {
+        g_source_remove (pkgclip->db_id);
+        pkgclip->db_id = 0;
     }
-    if (pkgclip->show_pkg_info && pkgclip->handler_pkg_info)
-        g_signal_handler_unblock (pkgclip->list, pkgclip->handler_pkg_info);
 }
 
 struct _err
 {
     pkgclip_t *pkgclip;
-    const gchar *cachedir;
+    gchar *cachedir;
 };
 
 static gboolean
@@ -388,92 +668,62 @@ thread_show_error (struct _err *err)
     snprintf (buf, 255, "Could not access cache directory %s", err->cachedir);
     show_error (buf, "Other cache directories (if any) will still be processed.",
             err->pkgclip);
+    g_free (err->cachedir);
     g_free (err);
     return FALSE;
 }
 
 static void
-thread_reload_list (pkgclip_t *pkgclip)
+thread_dir_error (const char *cachedir, pkgclip_t *pkgclip)
 {
-    alpm_list_t *cachedirs = alpm_option_get_cachedirs (pkgclip->handle);
-    alpm_list_t *i;
-
-    for (i = cachedirs; i; i = alpm_list_next (i))
-    {
-        const char *cachedir = i->data;
-        DIR *dir = opendir (cachedir);
-        struct dirent *ent;
+    struct _err *err;
 
-        if (dir == NULL)
-        {
-            struct _err *err;
-            err = g_new (struct _err, 1);
-            err->pkgclip = pkgclip;
-            err->cachedir = cachedir;
-            g_idle_add ((GSourceFunc) thread_show_error, err);
-            continue;
-        }
+    err = g_new (struct _err, 1);
+    err->pkgclip = pkgclip;
+    /* the handle (and its cachedirs) might be reset before it's shown */
+    err->cachedir = g_strdup (cachedir);
+    g_idle_add ((GSourceFunc) thread_show_error, err);
+}
 
-        rewinddir (dir);
-        /* step through the directory one file at a time */
-        while ((ent = readdir(dir)) != NULL)
-        {
-            char path[PATH_MAX];
-            size_t pathlen;
-            off_t filesize = 0;
-            struct stat statbuf;
-            alpm_pkg_t *pkg = NULL;
+static void
+thread_reload_list (pkgclip_t *pkgclip)
+{
+    scan_packages (thread_dir_error, pkgclip->loading, pkgclip);
+    g_idle_add ((GSourceFunc) post_reload_list, pkgclip);
+}
 
-            if (strcmp (ent->d_name, ".") == 0 || strcmp (ent->d_name, "..") == 0)
-                continue;
-            /* build the full filepath */
-            snprintf (path, PATH_MAX, "%s%s", cachedir, ent->d_name);
+/* adds packages loaded so far to the list, unclassified (see scan_packages) */
+static void
+load_batches (pkgclip_t *pkgclip)
+{
+    GPtrArray *batch;
+    GPtrArray *rows = NULL;
+    guint i;
 
-            /* we handle .sig files with packages, not separately */
-            pathlen = strlen (path);
-            if (strcmp (path + pathlen - 4, ".sig") == 0)
-                continue;
+    while ((batch = g_async_queue_try_pop (pkgclip->loading)))
+    {
+        for (i = 0; i < batch->len; ++i)
+        {
+            pc_pkg_t *pc_pkg = g_ptr_array_index (batch, i);
 
-            /* attempt to load the package (just the metadata) to ensure it's
-             * a valid package. */
-            if (alpm_pkg_load (pkgclip->handle, path, 0, 0, &pkg) != 0
-                    || pkg == NULL)
-            {
-                if (pkg)
-                    alpm_pkg_free (pkg);
-                continue;
-            }
             ++(pkgclip->total_packages);
-
-            /* get file size */
-            if (stat (path, &statbuf) == 0)
-            {
-                filesize = statbuf.st_size;
-                pkgclip->total_size += filesize;
-            }
-
-            /* new pc_pkg */
-            pc_pkg_t *pc_pkg;
-            pc_pkg = calloc (1, sizeof (*pc_pkg));
-            pc_pkg->file = strdup (path);
-            pc_pkg->filesize = filesize;
-            pc_pkg->pkg = pkg;
-            pc_pkg->name = alpm_pkg_get_name (pkg);
-            pc_pkg->version = alpm_pkg_get_version (pkg);
-            /* add it, sorted */
-            pkgclip->packages = alpm_list_add_sorted (pkgclip->packages, pc_pkg,
-                    (alpm_list_fn_cmp) pc_pkg_cmp);
-
-            if (pkgclip->abort)
-            {
-                closedir (dir);
-                goto done;
-            }
+            pkgclip->total_size += pc_pkg->filesize;
+            g_hash_table_insert (pkgclip->files, pc_pkg->file, pc_pkg);
+            if (rows)
+                g_ptr_array_add (rows, pc_pkg);
         }
-        closedir (dir);
+        /* all at once, so the model only needs sorting once */
+        if (!rows)
+            rows = batch;
+        else
+            g_ptr_array_unref (batch);
+    }
+
+    if (rows)
+    {
+        pc_list_model_append_rows (pkgclip->store, rows);
+        g_ptr_array_unref (rows);
     }
-done:
-    g_idle_add ((GSourceFunc) post_reload_list, pkgclip);
 }
 
 static gboolean
@@ -482,6 +732,9 @@ post_reload_list (pkgclip_t *pkgclip)
     if (pkgclip->abort)
         gtk_main_quit ();
 
+    /* whatever wasn't shown yet, for the totals */
+    load_batches (pkgclip);
+
     refresh_list (TRUE, pkgclip);
 
     if (pkgclip->show_pkg_info && pkgclip->handler_pkg_info)
@@ -499,16 +752,39 @@ refresh_label (pkgclip_t *pkgclip)
     if (!pkgclip->abort && pkgclip->is_loading)
     {
         gchar buf[255];
-        snprintf (buf, 255, "Loading packages (%d); Please wait...",
-                pkgclip->total_packages);
+
+        load_batches (pkgclip);
+        snprintf (buf, 255, "Loading packages (%d/%d files); Please wait...",
+                g_atomic_int_get (&pkgclip->nb_loaded),
+                g_atomic_int_get (&pkgclip->nb_found));
         gtk_label_set_text (GTK_LABEL (pkgclip->label), buf);
     }
     return pkgclip->is_loading;
 }
 
+static gboolean
+retry_reload_list (pkgclip_t *pkgclip)
+{
+    if (pkgclip->locked)
+        return TRUE;
+    pkgclip->reload_id = 0;
+    reload_list (pkgclip);
+    return FALSE;
+}
+
 static void
 reload_list (pkgclip_t *pkgclip)
 {
+    /* e.g. from the preferences, while packages are being loaded/removed: the
+     * arena (and cache) can't be replaced until they're done */
+    if (pkgclip->locked)
+    {
+        if (pkgclip->reload_id == 0)
+            pkgclip->reload_id = g_timeout_add (WATCH_DELAY,
+                    (GSourceFunc) retry_reload_list, pkgclip);
+        return;
+    }
+
     if (pkgclip->show_pkg_info && pkgclip->handler_pkg_info)
     {
         g_signal_handler_block (pkgclip->list, pkgclip->handler_pkg_info);
@@ -518,26 +794,18 @@ reload_list (pkgclip_t *pkgclip)
     set_locked (TRUE, pkgclip);
     pkgclip->is_loading = TRUE;
 
+    if (!pkgclip->loading)
+        pkgclip->loading = g_async_queue_new ();
     g_timeout_add (230, (GSourceFunc) refresh_label, pkgclip);
 
+    /* cachedirs might change */
+    unwatch_cachedirs (pkgclip);
+
     /* let's reset ALPM in case there was a DB update */
-    if (pkgclip->handle)
-        alpm_release (pkgclip->handle);
-    pkgclip->handle = NULL;
-    if (NULL != pkgclip->dbpath)
-    {
-        free (pkgclip->dbpath);
-        pkgclip->dbpath = NULL;
-    }
-    if (NULL != pkgclip->rootpath)
-    {
-        free (pkgclip->rootpath);
-        pkgclip->rootpath = NULL;
-    }
-    if (NULL != pkgclip->cachedirs)
-        FREELIST (pkgclip->cachedirs);
-    parse_pacmanconf (pkgclip);
-    init_alpm (pkgclip);
+    refresh_alpm (pkgclip);
+    /* started now so nothing is missed while scanning; changes will only be
+     * processed once loaded */
+    watch_cachedirs (pkgclip);
 
     g_thread_unref (g_thread_new ("reload-list",
                 (GThreadFunc) thread_reload_list, pkgclip));
@@ -547,7 +815,7 @@ static gboolean
 window_delete_event_cb (GtkWidget *window _UNUSED_, GdkEvent *event _UNUSED_,
                         pkgclip_t *pkgclip)
 {
-    if (pkgclip->is_loading)
+    if (pkgclip->is_loading || pkgclip->is_syncing)
     {
         quit (pkgclip);
         /* block closing window */
@@ -599,7 +867,7 @@ renderer_toggle_cb (GtkCellRendererToggle *renderer _UNUSED_, gchar *path, pkgcl
         --(pkgclip->marked_packages);
         pkgclip->marked_size -= pc_pkg->filesize;
     }
-    gtk_list_store_set (GTK_LIST_STORE (store), &iter, COL_REMOVE, pc_pkg->remove, -1);
+    pc_list_model_row_changed (pkgclip->store, pc_pkg);
     update_label (pkgclip);
 }
 
@@ -634,7 +902,7 @@ list_query_tooltip_cb (GtkWidget *widget, gint x, gint y, gboolean keyboard _UNU
             {
                 case COL_PACKAGE:
                     gtk_tree_model_get (model, &iter, COL_PC_PKG, &pc_pkg, -1);
-                    gtk_tooltip_set_text (tooltip, alpm_pkg_get_desc (pc_pkg->pkg));
+                    gtk_tooltip_set_text (tooltip, get_pc_pkg_desc (pc_pkg, pkgclip));
                     ret = TRUE;
                     break;
 
@@ -704,7 +972,7 @@ list_cursor_changed_cb (GtkTreeView *tree, pkgclip_t *pkgclip)
             if (v == VAR_NAME)
                 s = pc_pkg->name;
             else if (v == VAR_DESC)
-                s = alpm_pkg_get_desc (pc_pkg->pkg);
+                s = get_pc_pkg_desc (pc_pkg, pkgclip);
             else if (v == VAR_VERSION)
                 s = pc_pkg->version;
             else if (v == VAR_FILE)
@@ -774,6 +1042,27 @@ list_cursor_changed_cb (GtkTreeView *tree, pkgclip_t *pkgclip)
     gtk_tree_path_free (path);
 }
 
+static void
+progress_btn_cancel_cb (GtkButton *button, pkgclip_t *pkgclip)
+{
+    progress_win_t *progress_win = pkgclip->progress_win;
+
+    gtk_widget_set_sensitive (GTK_WIDGET (button), FALSE);
+    gtk_label_set_text (GTK_LABEL (progress_win->label),
+            "Cancelling removal; Please wait...");
+    progress_win->cancelled = TRUE;
+    /* no more paths will be sent; but some might be removed already */
+    if (progress_win->begun)
+        g_dbus_proxy_call (pkgclip->proxy,
+                "Cancel",
+                NULL,
+                G_DBUS_CALL_FLAGS_NONE,
+                -1,
+                NULL,
+                NULL,
+                NULL);
+}
+
 static void
 load_progress_window (pkgclip_t *pkgclip)
 {
@@ -807,23 +1096,136 @@ load_progress_window (pkgclip_t *pkgclip)
     gtk_box_pack_start (GTK_BOX(vbox), label, FALSE, FALSE, 0);
     gtk_widget_show (label);
 
-    /* progress bar */
-    GtkWidget *pbar;
-    pbar = gtk_progress_bar_new ();
-    progress_win->pbar = pbar;
-    gtk_box_pack_start (GTK_BOX(vbox), pbar, TRUE, TRUE, 0);
-    gtk_widget_show (pbar);
+    /* progress bar */
+    GtkWidget *pbar;
+    pbar = gtk_progress_bar_new ();
+    progress_win->pbar = pbar;
+    gtk_box_pack_start (GTK_BOX(vbox), pbar, TRUE, TRUE, 0);
+    gtk_widget_show (pbar);
+
+    /* hbox */
+    GtkWidget *hbox;
+    hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+    gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 4);
+    gtk_widget_show (hbox);
+
+    /* button Cancel */
+    GtkWidget *image;
+    GtkWidget *button;
+    image = gtk_image_new_from_icon_name ("gtk-cancel", GTK_ICON_SIZE_MENU);
+    button = gtk_button_new_with_label ("Cancel");
+    gtk_button_set_image (GTK_BUTTON (button), image);
+    progress_win->btn_cancel = button;
+    g_signal_connect (G_OBJECT (button), "clicked",
+            G_CALLBACK (progress_btn_cancel_cb), (gpointer) pkgclip);
+    gtk_box_pack_end (GTK_BOX (hbox), button, FALSE, FALSE, 0);
+    gtk_widget_show (button);
+
+    progress_win->paths = g_ptr_array_new_with_free_func (g_free);
+    progress_win->errors = g_array_new (FALSE, FALSE, sizeof (remove_error_t));
+    progress_win->strings = g_string_chunk_new (4096);
+    progress_win->pending = g_hash_table_new (g_str_hash, g_str_equal);
+
+    /* done */
+    pkgclip->progress_win = progress_win;
+}
+
+static void
+free_progress_window (pkgclip_t *pkgclip)
+{
+    g_array_unref (pkgclip->progress_win->errors);
+    g_string_chunk_free (pkgclip->progress_win->strings);
+    g_hash_table_unref (pkgclip->progress_win->pending);
+    g_ptr_array_unref (pkgclip->progress_win->paths);
+    g_free (pkgclip->progress_win->error);
+    free (pkgclip->progress_win);
+    pkgclip->progress_win = NULL;
+}
+
+/* errors (remove_error_t) grouped by message, with the number of files for
+ * each */
+static GtkWidget *
+new_errors_list (GArray *errors)
+{
+    GtkTreeStore *store;
+    GtkTreeIter iter;
+    GHashTable *groups;
+    GHashTableIter it;
+    const char *message;
+    GtkTreeIter *parent;
+    guint nb_groups;
+    guint i;
+
+    store = gtk_tree_store_new (2, G_TYPE_STRING, G_TYPE_INT);
+    /* messages are from a string chunk, so the same pointer for each */
+    groups = g_hash_table_new_full (NULL, NULL, NULL,
+            (GDestroyNotify) gtk_tree_iter_free);
+    for (i = 0; i < errors->len; ++i)
+    {
+        remove_error_t *error = &g_array_index (errors, remove_error_t, i);
+
+        parent = g_hash_table_lookup (groups, error->message);
+        if (!parent)
+        {
+            gtk_tree_store_insert_with_values (store, &iter, NULL, -1,
+                    0, error->message, -1);
+            parent = gtk_tree_iter_copy (&iter);
+            g_hash_table_insert (groups, (gpointer) error->message, parent);
+        }
+        gtk_tree_store_insert_with_values (store, NULL, parent, -1,
+                0, error->path, 1, 0, -1);
+    }
+
+    /* set counts */
+    g_hash_table_iter_init (&it, groups);
+    while (g_hash_table_iter_next (&it, (gpointer *) &message, (gpointer *) &parent))
+        gtk_tree_store_set (store, parent,
+                1, gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), parent),
+                -1);
+    nb_groups = g_hash_table_size (groups);
+    g_hash_table_unref (groups);
+
+    GtkWidget *list;
+    list = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+    g_object_unref (store);
+    gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (list), TRUE);
+
+    GtkCellRenderer *renderer;
+    GtkTreeViewColumn *column;
+
+    renderer = gtk_cell_renderer_text_new ();
+    column = gtk_tree_view_column_new_with_attributes ("Error", renderer,
+            "text", 0, NULL);
+    gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width (column, 340);
+    gtk_tree_view_column_set_resizable (column, TRUE);
+    gtk_tree_view_append_column (GTK_TREE_VIEW (list), column);
+
+    renderer = gtk_cell_renderer_text_new ();
+    column = gtk_tree_view_column_new ();
+    gtk_tree_view_column_set_title (column, "Files");
+    gtk_tree_view_column_pack_start (column, renderer, TRUE);
+    gtk_tree_view_column_set_cell_data_func (column, renderer,
+            (GtkTreeCellDataFunc) rend_error_count, NULL, NULL);
+    gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width (column, 60);
+    gtk_tree_view_append_column (GTK_TREE_VIEW (list), column);
+
+    /* only one type of error, show the files right away */
+    if (nb_groups == 1)
+        gtk_tree_view_expand_all (GTK_TREE_VIEW (list));
 
-    /* done */
-    pkgclip->progress_win = progress_win;
+    return list;
 }
 
 static void
-show_results (guint processed _UNUSED_, pkgclip_t *pkgclip)
+show_results (guint processed, pkgclip_t *pkgclip)
 {
     GtkMessageType type;
     const char *title;
     char subtitle[1024];
+    guint not_processed;
+    guint received;
 
     double success_size;
     const char *success_unit;
@@ -852,6 +1254,42 @@ show_results (guint processed _UNUSED_, pkgclip_t *pkgclip)
                 pkgclip->progress_win->error_files, error_size, error_unit);
     }
 
+    not_processed = g_hash_table_size (pkgclip->progress_win->pending);
+    if (pkgclip->progress_win->failed)
+    {
+        size_t len = strlen (subtitle);
+
+        type = GTK_MESSAGE_WARNING;
+        title = "Removal failed.";
+        snprintf (subtitle + len, 1024 - len, " Not all files could be sent: %s",
+                pkgclip->progress_win->error);
+    }
+    else if (pkgclip->progress_win->cancelled)
+    {
+        type = GTK_MESSAGE_WARNING;
+        title = "Removal cancelled.";
+    }
+    if (not_processed > 0)
+    {
+        size_t len = strlen (subtitle);
+
+        type = GTK_MESSAGE_WARNING;
+        snprintf (subtitle + len, 1024 - len, " %d files were not processed.",
+                not_processed);
+    }
+    /* results are all signaled before the reply, so this shouldn't happen;
+     * but if it does, what we show isn't exactly what was done */
+    received = pkgclip->progress_win->success_files + pkgclip->progress_win->error_files;
+    if (processed != received)
+    {
+        size_t len = strlen (subtitle);
+
+        type = GTK_MESSAGE_WARNING;
+        snprintf (subtitle + len, 1024 - len,
+                " The helper processed %d files, but results were received for %d.",
+                processed, received);
+    }
+
     /* the window */
     GtkWidget *dialog;
     dialog = gtk_message_dialog_new (
@@ -880,12 +1318,54 @@ show_results (guint processed _UNUSED_, pkgclip_t *pkgclip)
         gtk_container_add (GTK_CONTAINER (expander), scrolled);
         gtk_widget_show (scrolled);
 
-        GtkWidget *label;
-        label = gtk_label_new (NULL);
-        gtk_label_set_markup (GTK_LABEL (label), pkgclip->progress_win->error_messages);
-        gtk_label_set_selectable (GTK_LABEL (label), TRUE);
-        gtk_container_add (GTK_CONTAINER (scrolled), label);
-        gtk_widget_show (label);
+        gtk_scrolled_window_set_min_content_height (GTK_SCROLLED_WINDOW (scrolled), 200);
+
+        GtkWidget *list;
+        list = new_errors_list (pkgclip->progress_win->errors);
+        gtk_container_add (GTK_CONTAINER (scrolled), list);
+        gtk_widget_show (list);
+    }
+    if (not_processed > 0)
+    {
+        GtkWidget *vbox;
+        vbox = gtk_message_dialog_get_message_area (GTK_MESSAGE_DIALOG (dialog));
+
+        GtkWidget *expander;
+        expander = gtk_expander_new ("Files not processed");
+        gtk_box_pack_start (GTK_BOX (vbox), expander, TRUE, TRUE, 0);
+        gtk_widget_show (expander);
+
+        GtkWidget *scrolled;
+        scrolled = gtk_scrolled_window_new (NULL, NULL);
+        gtk_container_add (GTK_CONTAINER (expander), scrolled);
+        gtk_widget_show (scrolled);
+
+        gtk_scrolled_window_set_min_content_height (GTK_SCROLLED_WINDOW (scrolled), 200);
+
+        /* same list as for errors, with why they weren't processed */
+        GArray *files;
+        remove_error_t file;
+        guint i;
+        files = g_array_sized_new (FALSE, FALSE, sizeof (remove_error_t), not_processed);
+        if (pkgclip->progress_win->failed)
+            file.message = pkgclip->progress_win->error;
+        else if (pkgclip->progress_win->cancelled)
+            file.message = "Removal cancelled";
+        else
+            file.message = "No result received";
+        file.err = 0;
+        for (i = 0; i < pkgclip->progress_win->paths->len; ++i)
+        {
+            file.path = g_ptr_array_index (pkgclip->progress_win->paths, i);
+            if (g_hash_table_contains (pkgclip->progress_win->pending, file.path))
+                g_array_append_val (files, file);
+        }
+
+        GtkWidget *list;
+        list = new_errors_list (files);
+        gtk_container_add (GTK_CONTAINER (scrolled), list);
+        gtk_widget_show (list);
+        g_array_unref (files);
     }
 
     /* done */
@@ -893,102 +1373,102 @@ show_results (guint processed _UNUSED_, pkgclip_t *pkgclip)
     gtk_widget_destroy (dialog);
 
     /* free */
-    free (pkgclip->progress_win->error_messages);
-    free (pkgclip->progress_win);
-    pkgclip->progress_win = NULL;
+    free_progress_window (pkgclip);
 }
 
 static void
-on_signal (GDBusProxy *proxy _UNUSED_,
-           gchar      *sender_name _UNUSED_,
-           gchar      *signal_name,
-           GVariant   *parameters,
-           pkgclip_t  *pkgclip)
+add_result (const gchar *pkg_name, gint status, const gchar *error,
+            pkgclip_t *pkgclip)
 {
-    const gchar *pkg_name;
-    const gchar *error;
-    gboolean is_success;
+    pc_pkg_t *pc_pkg;
 
-    if (g_strcmp0 (signal_name, "RemoveSuccess") == 0)
-    {
-        is_success = TRUE;
+    g_hash_table_remove (pkgclip->progress_win->pending, pkg_name);
+    if (status == 0)
         ++(pkgclip->progress_win->success_files);
-        g_variant_get (parameters, "(s)", &pkg_name);
-    }
-    else if (g_strcmp0 (signal_name, "RemoveFailure") == 0)
+    else
     {
-        is_success = FALSE;
+        remove_error_t err;
+
         ++(pkgclip->progress_win->error_files);
-        g_variant_get (parameters, "(ss)", &pkg_name, &error);
+        err.path = g_string_chunk_insert (pkgclip->progress_win->strings, pkg_name);
+        err.err = status;
+        err.message = g_string_chunk_insert_const (pkgclip->progress_win->strings, error);
+        g_array_append_val (pkgclip->progress_win->errors, err);
+    }
 
-        gchar buf[1024];
-        size_t len;
-        snprintf (buf, 1024, "%s:\n<span color=\"red\">%s</span>\n\n", pkg_name, error);
-        len = strlen (buf);
+    /* .sig files aren't in there */
+    pc_pkg = g_hash_table_lookup (pkgclip->files, pkg_name);
+    if (!pc_pkg)
+        return;
 
-        if (pkgclip->progress_win->em_len + len + 1 >= pkgclip->progress_win->em_alloc)
-        {
-            pkgclip->progress_win->em_alloc += (guint) len + 1024;
-            pkgclip->progress_win->error_messages = (char *) realloc (
-                    pkgclip->progress_win->error_messages,
-                    pkgclip->progress_win->em_alloc * sizeof (char *));
-            /* if we've just init it, we need to zero it so strcat works fine */
-            if (pkgclip->progress_win->em_alloc == len + 1024)
-                *(pkgclip->progress_win->error_messages) = '\0';
-        }
-        strcat (pkgclip->progress_win->error_messages, buf);
-        pkgclip->progress_win->em_len += (guint) len;
+    if (status == 0)
+    {
+        pkgclip->progress_win->success_size += pc_pkg->filesize;
+        /* update counters */
+        --(pkgclip->total_packages);
+        pkgclip->total_size -= pc_pkg->filesize;
+        --(pkgclip->marked_packages);
+        pkgclip->marked_size -= pc_pkg->filesize;
+        /* it will be dropped from list & model once done (the list is locked
+         * meanwhile, so no need to update the row) */
+        g_hash_table_remove (pkgclip->files, pc_pkg->file);
+        pc_pkg->removed = TRUE;
+        pc_pkg->remove = FALSE;
     }
     else
+        pkgclip->progress_win->error_size += pc_pkg->filesize;
+}
+
+static void
+on_signal (GDBusProxy *proxy _UNUSED_,
+           gchar      *sender_name _UNUSED_,
+           gchar      *signal_name,
+           GVariant   *parameters,
+           pkgclip_t  *pkgclip)
+{
+    GVariantIter *iter;
+    const gchar *pkg_name;
+    const gchar *error;
+    gint status;
+
+    if (g_strcmp0 (signal_name, "RemoveProgress") != 0)
         return;
 
+    /* results come in batches, so we only update the progress bar once for
+     * the whole batch */
+    g_variant_get (parameters, "(a(sis))", &iter);
+    while (g_variant_iter_next (iter, "(&si&s)", &pkg_name, &status, &error))
+        add_result (pkg_name, status, error, pkgclip);
+    g_variant_iter_free (iter);
+
     gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (pkgclip->progress_win->pbar),
             (double) (pkgclip->progress_win->success_files
                 + pkgclip->progress_win->error_files)
             / pkgclip->progress_win->total_files);
+}
 
-    GtkTreeModel *model = GTK_TREE_MODEL (pkgclip->store);
-    GtkTreeIter iter;
-    pc_pkg_t *pc_pkg;
-
-    if (!gtk_tree_model_get_iter_first (model, &iter))
-        return;
+/* drops all packages whose files were removed, at once. Their records remain
+ * in the arena, accounted as dead (see reload_if_wasteful) */
+static void
+compact_packages (pkgclip_t *pkgclip)
+{
+    guint i, j;
 
-    while (1)
+    for (i = j = 0; i < pkgclip->packages->len; ++i)
     {
-        gtk_tree_model_get (model, &iter, COL_PC_PKG, &pc_pkg, -1);
-        if (strcmp (pkg_name, pc_pkg->file) == 0)
-        {
-            if (is_success)
-            {
-                pkgclip->progress_win->success_size += pc_pkg->filesize;
-                /* remove pc_pkg from list of packages */
-                alpm_list_t *i;
-                for (i = pkgclip->packages; i; i = alpm_list_next (i))
-                {
-                    if (i->data == pc_pkg)
-                    {
-                        pkgclip->packages = alpm_list_remove_item (pkgclip->packages, i);
-                        break;
-                    }
-                }
-                /* remove from store */
-                gtk_list_store_remove (GTK_LIST_STORE (model), &iter);
-                /* update counters */
-                --(pkgclip->total_packages);
-                pkgclip->total_size -= pc_pkg->filesize;
-                --(pkgclip->marked_packages);
-                pkgclip->marked_size -= pc_pkg->filesize;
-                /* free memory */
-                free_pc_pkg (pc_pkg);
-            }
-            else
-                pkgclip->progress_win->error_size += pc_pkg->filesize;
-            break;
-        }
-        if (!gtk_tree_model_iter_next (model, &iter))
-            break;
+        pc_pkg_t *pc_pkg = g_ptr_array_index (pkgclip->packages, i);
+
+        if (!pc_pkg->removed)
+            pkgclip->packages->pdata[j++] = pc_pkg;
+        else
+            arena_release (pkgclip->arena, pc_pkg_size (pc_pkg));
     }
+    if (j == i)
+        return;
+
+    g_ptr_array_set_size (pkgclip->packages, (gint) j);
+
+    load_list_model (pkgclip);
 }
 
 static void
@@ -996,11 +1476,14 @@ dbus_method_cb (GObject *source _UNUSED_, GAsyncResult *result, pkgclip_t *pkgcl
 {
     GError *error = NULL;
     GVariant *ret;
+    gboolean reloading;
 
     gtk_widget_destroy (pkgclip->progress_win->window);
 
+    compact_packages (pkgclip);
     set_locked (FALSE, pkgclip);
     update_label (pkgclip);
+    reloading = reload_if_wasteful (pkgclip);
 
     ret = g_dbus_proxy_call_finish (pkgclip->proxy, result, &error);
     if (ret == NULL)
@@ -1008,20 +1491,255 @@ dbus_method_cb (GObject *source _UNUSED_, GAsyncResult *result, pkgclip_t *pkgcl
         show_error ("Unable to remove packages", error->message, pkgclip);
         g_error_free (error);
         /* free */
-        free (pkgclip->progress_win->error_messages);
-        free (pkgclip->progress_win);
-        pkgclip->progress_win = NULL;
+        free_progress_window (pkgclip);
         return;
     }
 
-    /* to update reasons w/ new list of packages */
-    refresh_list (FALSE, pkgclip);
+    /* to update reasons w/ new list of packages (unless reloaded) */
+    if (!reloading)
+        reclassify_list (pkgclip);
 
     guint processed;
     g_variant_get (ret, "(i)", &processed);
     show_results (processed, pkgclip);
 }
 
+#define PATHS_CHUNK         1024
+
+/* files are sent to the helper as the index of their cachedir, and their name
+ * in there */
+static gboolean
+get_entry (const char *path, guint *idx, const char **name, pkgclip_t *pkgclip)
+{
+    alpm_list_t *i;
+    guint n;
+
+    if (!pkgclip->handle)
+        return FALSE;
+    for (i = alpm_option_get_cachedirs (pkgclip->handle), n = 0;
+            i;
+            i = alpm_list_next (i), ++n)
+    {
+        const char *cachedir = i->data;
+        size_t len = strlen (cachedir);
+
+        if (strncmp (path, cachedir, len) == 0
+                && path[len] != '\0' && !strchr (path + len, '/'))
+        {
+            *idx = n;
+            *name = path + len;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void
+add_entries_cb (GObject *source _UNUSED_, GAsyncResult *result, pkgclip_t *pkgclip)
+{
+    GError *error = NULL;
+    GVariant *ret;
+
+    ret = g_dbus_proxy_call_finish (pkgclip->proxy, result, &error);
+    if (ret)
+    {
+        g_variant_unref (ret);
+        return;
+    }
+    /* files from that chunk won't be processed, so we stop sending more and
+     * end the session; they'll be reported as not processed */
+    if (pkgclip->progress_win && !pkgclip->progress_win->failed)
+    {
+        pkgclip->progress_win->failed = TRUE;
+        pkgclip->progress_win->error = g_strdup (error->message);
+    }
+    g_error_free (error);
+}
+
+static gboolean
+send_paths (pkgclip_t *pkgclip)
+{
+    progress_win_t *progress_win = pkgclip->progress_win;
+    GVariantBuilder *builder;
+    guint i;
+
+    if (progress_win->cancelled || progress_win->failed
+            || progress_win->next >= progress_win->paths->len)
+    {
+        /* wait for all files to be processed, and end the session */
+        g_dbus_proxy_call (pkgclip->proxy,
+                "Commit",
+                NULL,
+                G_DBUS_CALL_FLAGS_NONE,
+                G_MAXINT,
+                NULL,
+                (GAsyncReadyCallback) dbus_method_cb,
+                (gpointer) pkgclip);
+        return G_SOURCE_REMOVE;
+    }
+
+    /* paths are sent in chunks, so files get removed while we're still
+     * sending more, and we can stop sending when cancelled */
+    builder = g_variant_builder_new (G_VARIANT_TYPE ("a(us)"));
+    for (i = 0; i < PATHS_CHUNK && progress_win->next < progress_win->paths->len; ++i)
+    {
+        const char *path = g_ptr_array_index (progress_win->paths, progress_win->next++);
+        const char *name;
+        guint idx;
+
+        /* paths were all checked already */
+        get_entry (path, &idx, &name, pkgclip);
+        g_variant_builder_add (builder, "(us)", idx, name);
+    }
+    g_dbus_proxy_call (pkgclip->proxy,
+            "AddEntries",
+            g_variant_new ("(a(us))", builder),
+            G_DBUS_CALL_FLAGS_NONE,
+            -1,
+            NULL,
+            (GAsyncReadyCallback) add_entries_cb,
+            (gpointer) pkgclip);
+    g_variant_builder_unref (builder);
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+add_paths_fd_cb (GObject *source _UNUSED_, GAsyncResult *result, pkgclip_t *pkgclip)
+{
+    GVariant *ret;
+
+    ret = g_dbus_proxy_call_with_unix_fd_list_finish (pkgclip->proxy, NULL,
+            result, NULL);
+    if (ret)
+    {
+        /* all paths were sent */
+        pkgclip->progress_win->next = pkgclip->progress_win->paths->len;
+        g_variant_unref (ret);
+    }
+    /* else we'll simply send them in chunks instead */
+    g_idle_add ((GSourceFunc) send_paths, pkgclip);
+}
+
+/* sends all entries at once through a sealed memfd -- index & name separated by
+ * a slash, NUL-terminated -- instead of going through the bus. Returns FALSE if
+ * not possible */
+static gboolean
+send_paths_fd (pkgclip_t *pkgclip)
+{
+    progress_win_t *progress_win = pkgclip->progress_win;
+    GUnixFDList *fd_list;
+    GString *str;
+    const char *s;
+    ssize_t len;
+    gsize left;
+    int fd;
+    guint i;
+
+    fd = memfd_create ("pkgclip-entries", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+        return FALSE;
+
+    str = g_string_sized_new (64 * progress_win->paths->len);
+    for (i = 0; i < progress_win->paths->len; ++i)
+    {
+        const char *name;
+        guint idx;
+
+        get_entry (g_ptr_array_index (progress_win->paths, i), &idx, &name, pkgclip);
+        g_string_append_printf (str, "%u/%s", idx, name);
+        g_string_append_c (str, '\0');
+    }
+    for (s = str->str, left = str->len; left > 0; s += len, left -= (gsize) len)
+    {
+        len = write (fd, s, left);
+        if (len < 0)
+        {
+            if (errno == EINTR)
+            {
+                len = 0;
+                continue;
+            }
+            g_string_free (str, TRUE);
+            goto err;
+        }
+    }
+    g_string_free (str, TRUE);
+    if (fcntl (fd, F_ADD_SEALS,
+                F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+        goto err;
+
+    /* takes ownership of fd */
+    fd_list = g_unix_fd_list_new_from_array (&fd, 1);
+    g_dbus_proxy_call_with_unix_fd_list (pkgclip->proxy,
+            "AddEntriesFromFd",
+            g_variant_new ("(h)", 0),
+            G_DBUS_CALL_FLAGS_NONE,
+            -1,
+            fd_list,
+            NULL,
+            (GAsyncReadyCallback) add_paths_fd_cb,
+            (gpointer) pkgclip);
+    g_object_unref (fd_list);
+    return TRUE;
+
+err:
+    close (fd);
+    return FALSE;
+}
+
+static void
+begin_removal_cb (GObject *source _UNUSED_, GAsyncResult *result, pkgclip_t *pkgclip)
+{
+    GError *error = NULL;
+    GVariant *ret;
+
+    ret = g_dbus_proxy_call_finish (pkgclip->proxy, result, &error);
+    if (ret == NULL)
+    {
+        gtk_widget_destroy (pkgclip->progress_win->window);
+        set_locked (FALSE, pkgclip);
+        show_error ("Unable to remove packages", error->message, pkgclip);
+        g_error_free (error);
+        free_progress_window (pkgclip);
+        return;
+    }
+    g_variant_unref (ret);
+
+    pkgclip->progress_win->begun = TRUE;
+    /* cancelled while waiting for the helper (e.g. on the authentication
+     * prompt): Cancel wasn't sent, so no paths must be; send_paths will only
+     * end the session */
+    if (pkgclip->progress_win->cancelled)
+    {
+        send_paths (pkgclip);
+        return;
+    }
+    /* more than a chunk, send them all through a memfd if possible */
+    if (pkgclip->progress_win->paths->len > PATHS_CHUNK && send_paths_fd (pkgclip))
+        return;
+    g_idle_add ((GSourceFunc) send_paths, pkgclip);
+}
+
+static void
+add_path (const char *path, pkgclip_t *pkgclip)
+{
+    const char *name;
+    guint idx;
+    char *s;
+
+    ++pkgclip->progress_win->total_files;
+    /* the helper will only remove files from within a cachedir */
+    if (!get_entry (path, &idx, &name, pkgclip))
+    {
+        add_result (path, EINVAL, "Not within a cache directory", pkgclip);
+        return;
+    }
+
+    s = g_strdup (path);
+    g_ptr_array_add (pkgclip->progress_win->paths, s);
+    g_hash_table_add (pkgclip->progress_win->pending, s);
+}
+
 static void
 select_prev_next_marked (gboolean next, pkgclip_t *pkgclip)
 {
@@ -1108,7 +1826,7 @@ static void
 btn_remove_cb (gpointer p _UNUSED_, pkgclip_t *pkgclip)
 {
     GError *error = NULL;
-    alpm_list_t *i;
+    guint i;
     char buf[255];
     double size;
     const char *unit;
@@ -1154,42 +1872,42 @@ btn_remove_cb (gpointer p _UNUSED_, pkgclip_t *pkgclip)
     load_progress_window (pkgclip);
     pkgclip->progress_win->total_files = 0;
 
-    GVariantBuilder *builder;
-
-    builder = g_variant_builder_new (G_VARIANT_TYPE ("as"));
-    for (i = pkgclip->packages; i; i = alpm_list_next (i))
+    for (i = 0; i < pkgclip->packages->len; ++i)
     {
-        pc_pkg_t *pc_pkg = i->data;
+        pc_pkg_t *pc_pkg = g_ptr_array_index (pkgclip->packages, i);
 
         if (pc_pkg->remove)
         {
             char b[255];
 
-            g_variant_builder_add (builder, "s", pc_pkg->file);
-            ++pkgclip->progress_win->total_files;
+            add_path (pc_pkg->file, pkgclip);
             if (pkgclip->remove_sig
                     && snprintf (b, 255, "%s.sig", pc_pkg->file) < 255)
             {
                 struct stat sb;
 
                 if (stat (b, &sb) == 0)
-                {
-                    g_variant_builder_add (builder, "s", b);
-                    ++pkgclip->progress_win->total_files;
-                }
+                    add_path (b, pkgclip);
             }
         }
     }
 
     gtk_widget_show (pkgclip->progress_win->window);
 
+    GVariantBuilder *builder;
+    alpm_list_t *l;
+
+    builder = g_variant_builder_new (G_VARIANT_TYPE ("as"));
+    for (l = alpm_option_get_cachedirs (pkgclip->handle); l; l = alpm_list_next (l))
+        g_variant_builder_add (builder, "s", l->data);
     g_dbus_proxy_call (pkgclip->proxy,
-            "RemovePackages",
+            "BeginRemoval",
             g_variant_new ("(as)", builder),
             G_DBUS_CALL_FLAGS_NONE,
-            -1,
+            /* no timeout, the user might take a while to authenticate */
+            G_MAXINT,
             NULL,
-            (GAsyncReadyCallback) dbus_method_cb,
+            (GAsyncReadyCallback) begin_removal_cb,
             (gpointer) pkgclip);
     g_variant_builder_unref (builder);
 }
@@ -1230,7 +1948,7 @@ change_marked_selection_foreach (GtkTreeModel *model,
             --(pkgclip->marked_packages);
             pkgclip->marked_size -= pc_pkg->filesize;
         }
-        gtk_list_store_set (GTK_LIST_STORE (model), iter, COL_REMOVE, pc_pkg->remove, -1);
+        pc_list_model_row_changed (pkgclip->store, pc_pkg);
     }
 }
 
@@ -1246,10 +1964,13 @@ change_marked (mark_t marked, gint reason, pkgclip_t *pkgclip)
     {
         void *ptr[2] = {(void *) marked, (void *) pkgclip};
 
+        /* rows only move once all are changed */
+        pc_list_model_freeze_sort (pkgclip->store);
         gtk_tree_selection_selected_foreach (gtk_tree_view_get_selection (
                     GTK_TREE_VIEW (pkgclip->list)),
                 (GtkTreeSelectionForeachFunc) change_marked_selection_foreach,
                 (gpointer) ptr);
+        pc_list_model_thaw_sort (pkgclip->store);
         update_label (pkgclip);
         return;
     }
@@ -1258,6 +1979,8 @@ change_marked (mark_t marked, gint reason, pkgclip_t *pkgclip)
         if (!gtk_tree_model_get_iter_first (model, &iter))
             return;
 
+        /* rows only move once all are changed, so iterating isn't affected */
+        pc_list_model_freeze_sort (pkgclip->store);
         while (1)
         {
             gint r;
@@ -1286,11 +2009,12 @@ change_marked (mark_t marked, gint reason, pkgclip_t *pkgclip)
                     --(pkgclip->marked_packages);
                     pkgclip->marked_size -= pc_pkg->filesize;
                 }
-                gtk_list_store_set (GTK_LIST_STORE (model), &iter, COL_REMOVE, pc_pkg->remove, -1);
+                pc_list_model_row_changed (pkgclip->store, pc_pkg);
             }
             if (!gtk_tree_model_iter_next (model, &iter))
                 break;
         }
+        pc_list_model_thaw_sort (pkgclip->store);
         update_label (pkgclip);
     }
 }
@@ -1348,7 +2072,7 @@ change_as_installed_selection_foreach (GtkTreeModel *model,
                                  void *ptr[3])
 {
     gboolean adding = GPOINTER_TO_INT (ptr[0]);
-    gboolean *changed = (gboolean *) ptr[1];
+    alpm_list_t **changed = (alpm_list_t **) ptr[1];
     pkgclip_t *pkgclip = (pkgclip_t *) ptr[2];
     pc_pkg_t *pc_pkg;
     alpm_list_t *i, *item = NULL;
@@ -1370,7 +2094,7 @@ change_as_installed_selection_foreach (GtkTreeModel *model,
         {
             pkgclip->as_installed = alpm_list_add (pkgclip->as_installed,
                     strdup (pc_pkg->name));
-            *changed = TRUE;
+            *changed = alpm_list_add (*changed, pc_pkg->name);
         }
     }
     else if (!adding)
@@ -1379,7 +2103,7 @@ change_as_installed_selection_foreach (GtkTreeModel *model,
                 item);
         free (item->data);
         free (item);
-        *changed = TRUE;
+        *changed = alpm_list_add (*changed, pc_pkg->name);
     }
 
 }
@@ -1387,7 +2111,7 @@ change_as_installed_selection_foreach (GtkTreeModel *model,
 static void
 change_as_installed (gboolean adding, pkgclip_t *pkgclip)
 {
-    gboolean changed = FALSE;
+    alpm_list_t *changed = NULL, *i;
     void *ptr[3] = {GINT_TO_POINTER (adding), (void *) &changed, (void *) pkgclip};
 
     gtk_tree_selection_selected_foreach (gtk_tree_view_get_selection (
@@ -1396,7 +2120,10 @@ change_as_installed (gboolean adding, pkgclip_t *pkgclip)
             (gpointer) ptr);
     if (changed)
     {
-        refresh_list (FALSE, pkgclip);
+        /* only those packages need to be reclassified */
+        for (i = changed; i; i = alpm_list_next (i))
+            reclassify_package (i->data, pkgclip);
+        alpm_list_free (changed);
         if (save_config (pkgclip))
             gtk_label_set_text (GTK_LABEL (pkgclip->label), "Preferences saved.");
     }
@@ -1527,6 +2254,27 @@ prefs_btn_ok_cb (GtkButton *button, pkgclip_t *pkgclip)
             needs_save = TRUE;
         }
 
+        is_on = gtk_toggle_button_get_active (
+                GTK_TOGGLE_BUTTON (pkgclip->prefs->chk_fast_scan));
+        if (is_on != pkgclip->fast_scan)
+        {
+            pkgclip->fast_scan = is_on;
+            needs_save = TRUE;
+        }
+
+        is_on = gtk_toggle_button_get_active (
+                GTK_TOGGLE_BUTTON (pkgclip->prefs->chk_watch_cache));
+        if (is_on != pkgclip->watch_cache)
+        {
+            pkgclip->watch_cache = is_on;
+            needs_save = TRUE;
+            /* only once packages were loaded (or are being) */
+            if (!is_on)
+                unwatch_cachedirs (pkgclip);
+            else if (pkgclip->snapshot || pkgclip->is_loading)
+                watch_cachedirs (pkgclip);
+        }
+
         is_on = gtk_toggle_button_get_active (
                 GTK_TOGGLE_BUTTON (pkgclip->prefs->chk_show_pkg_info));
         if (is_on != pkgclip->show_pkg_info)
@@ -1615,17 +2363,29 @@ prefs_btn_ok_cb (GtkButton *button, pkgclip_t *pkgclip)
                     }
                 }
             }
+            needs_refresh = TRUE;
             needs_save = TRUE;
         }
     }
     /* Clear */
     else
     {
+        if (strcmp (pkgclip->pacmanconf, PACMAN_CONF) != 0)
+            needs_reload = TRUE;
+        else
+            needs_refresh = TRUE;
         free (pkgclip->pacmanconf);
         pkgclip->pacmanconf = strdup (PACMAN_CONF);
         pkgclip->nb_old_ver = 1;
         pkgclip->old_pkgrel = TRUE;
         pkgclip->autoload = TRUE;
+        pkgclip->fast_scan = FALSE;
+        if (!pkgclip->watch_cache)
+        {
+            pkgclip->watch_cache = TRUE;
+            if (pkgclip->snapshot || pkgclip->is_loading)
+                watch_cachedirs (pkgclip);
+        }
         FREELIST (pkgclip->as_installed);
         pkgclip->nb_old_ver_ai = 0;
         pkgclip->remove_sig = TRUE;
@@ -1638,15 +2398,13 @@ prefs_btn_ok_cb (GtkButton *button, pkgclip_t *pkgclip)
         pkgclip->recomm[REASON_PKG_NOT_INSTALLED]       = RECOMM_REMOVE;
 
         pkgclip->recomm[REASON_AS_INSTALLED] = pkgclip->recomm[REASON_INSTALLED];
-
-        needs_reload = TRUE;
     }
 
-    /* reload/refresh */
+    /* reload/reclassify */
     if (needs_reload)
         reload_list (pkgclip);
     else if (needs_refresh)
-        refresh_list (FALSE, pkgclip);
+        reclassify_list (pkgclip);
 
     /* save */
     if (btn_id == 1)
@@ -1844,6 +2602,24 @@ menu_preferences_cb (GtkMenuItem *menuitem _UNUSED_, pkgclip_t *pkgclip)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (check), !pkgclip->autoload);
     gtk_widget_show (check);
 
+    /* fast scan */
+    check = gtk_check_button_new_with_label ("Fast scan (read packages info from file names)");
+    pkgclip->prefs->chk_fast_scan = check;
+    gtk_grid_attach (GTK_GRID (grid), check, 0, top++, 2, 1);
+    gtk_widget_set_margin_start (check, 23);
+    gtk_widget_set_tooltip_text (check, "Do not open package files when loading packages; Descriptions will be read only when needed");
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (check), pkgclip->fast_scan);
+    gtk_widget_show (check);
+
+    /* watch cache */
+    check = gtk_check_button_new_with_label ("Watch cache directories for changes");
+    pkgclip->prefs->chk_watch_cache = check;
+    gtk_grid_attach (GTK_GRID (grid), check, 0, top++, 2, 1);
+    gtk_widget_set_margin_start (check, 23);
+    gtk_widget_set_tooltip_text (check, "Keep the list up to date as packages are added to or removed from the cache directories, and recommendations as packages are installed/removed, without reloading");
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (check), pkgclip->watch_cache);
+    gtk_widget_show (check);
+
     /* show package info */
     check = gtk_check_button_new_with_label ("Show package information. \t Template:");
     pkgclip->prefs->chk_show_pkg_info = check;
@@ -2130,6 +2906,15 @@ main (int argc, char *argv[])
             printf ("PkgClip - " PACKAGE_TAG " v" PACKAGE_VERSION "\n\n");
             printf (" -h, --help        Show this help screen and exit\n");
             printf (" -V, --version     Show version information and exit\n");
+            printf ("\nHeadless mode (no GUI):\n");
+            printf (" --list                    List packages, recommendation & reason\n");
+            printf (" --dry-run                 List files that would be removed\n");
+            printf (" --remove                  Remove files recommended for removal\n");
+            printf (" --format FORMAT           Output format: text, jsonl, csv or nul\n");
+            printf (" --nb-old-versions N       Number of old versions to keep\n");
+            printf (" --nb-old-versions-ai N    Same, for packages treated as installed\n");
+            printf (" --as-installed PKG        Treat PKG as installed (repeatable)\n");
+            printf (" --recomm REASON=VALUE     Set recommendation (Keep/Remove) for REASON\n");
             printf ("\nFor more, please refer to the man page: man pkgclip\n");
             return 0;
         }
@@ -2145,9 +2930,15 @@ main (int argc, char *argv[])
         }
     }
 
+    if (is_headless (argc, argv))
+        return run_headless (argc, argv);
+
     gtk_init (&argc, &argv);
-    pkgclip = new_pkgclip ();
-    init_alpm (pkgclip);
+    pkgclip = new_pkgclip (show_error_dialog);
+    pkgclip->packages = g_ptr_array_new ();
+    pkgclip->arena = arena_new ();
+    pkgclip->files = g_hash_table_new (g_str_hash, g_str_equal);
+    refresh_alpm (pkgclip);
 
     /* use to set images on menus/buttons */
     GtkWidget *image;
@@ -2567,19 +3358,9 @@ main (int argc, char *argv[])
     gtk_container_add (GTK_CONTAINER (menubar), menuitem);
     gtk_widget_show (menuitem);
 
-    /* store for the list */
-    GtkListStore *store;
-    store = gtk_list_store_new (COL_NB,
-            G_TYPE_POINTER, /* pc_pkg */
-            G_TYPE_STRING,  /* package */
-            G_TYPE_STRING,  /* version */
-            G_TYPE_UINT,    /* size */
-            G_TYPE_BOOLEAN, /* remove */
-            G_TYPE_INT,     /* recomm */
-            G_TYPE_INT,     /* reason */
-            G_TYPE_INT,     /* nb old ver */
-            G_TYPE_INT      /* nb old ver total */
-            );
+    /* model for the list, reading from the packages directly */
+    PcListModel *store;
+    store = pc_list_model_new ();
     pkgclip->store = store;
     /* set our custom sort function for COL_PACKAGE */
     gtk_tree_sortable_set_sort_func (GTK_TREE_SORTABLE (store), COL_PACKAGE,
@@ -2808,10 +3589,29 @@ main (int argc, char *argv[])
         free (mnu_reasons_desc_unselect[i]);
     }
 
+    unwatch_cachedirs (pkgclip);
+    if (pkgclip->loading)
+    {
+        GPtrArray *batch;
+
+        /* if aborted while loading */
+        while ((batch = g_async_queue_try_pop (pkgclip->loading)))
+            g_ptr_array_unref (batch);
+        g_async_queue_unref (pkgclip->loading);
+    }
+
     /* free alpm */
     if (pkgclip->handle && alpm_release (pkgclip->handle) == -1)
         g_warning ("Failed to properly release ALPM library");
 
+    if (pkgclip->reload_id > 0)
+        g_source_remove (pkgclip->reload_id);
+    scan_free_cache (pkgclip);
+    g_hash_table_unref (pkgclip->files);
+    g_ptr_array_unref (pkgclip->packages);
+    arena_free (pkgclip->arena);
+    if (pkgclip->snapshot)
+        snapshot_free (pkgclip->snapshot);
     free_pkgclip (pkgclip);
     return 0;
 }
@@ -0,0 +1,276 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * mdcache.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+/* C */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* pkgclip */
+#include "common.h"
+#include "mdcache.h"
+
+/* The metadata cache is a file holding, for each package file found in a cache
+ * directory, the info we need from it (name, version, desc & arch) so we don't
+ * have to open the archive again on the next reload, as long as the file is
+ * unchanged (same inode, size & mtime).
+ *
+ * The file is made of NUL-terminated fields: first MDCACHE_MAGIC, then for each
+ * entry: cachedir, filename, inode, size, mtime, mtime_nsec, name, version,
+ * desc and arch.
+ *
+ * Entries loaded from the file point into its contents, new ones into a string
+ * chunk; so only the entries themselves need to be freed.
+ */
+
+#define NB_FIELDS       10
+
+static char *
+next_field (char **s, const char *end)
+{
+    char *field = *s;
+    char *e;
+
+    if (field >= end)
+        return NULL;
+    e = memchr (field, '\0', (size_t) (end - field));
+    if (!e)
+        return NULL;
+    *s = e + 1;
+    return field;
+}
+
+static GHashTable *
+get_dir (mdcache_t *mdcache, const char *cachedir, gboolean create)
+{
+    GHashTable *dir;
+
+    dir = g_hash_table_lookup (mdcache->dirs, cachedir);
+    if (!dir && create)
+    {
+        dir = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+        g_hash_table_insert (mdcache->dirs,
+                g_string_chunk_insert_const (mdcache->strings, cachedir),
+                dir);
+    }
+    return dir;
+}
+
+/* returns an empty cache, only kept in memory (i.e. never saved) */
+mdcache_t *
+mdcache_new (void)
+{
+    mdcache_t *mdcache;
+
+    mdcache = calloc (1, sizeof (*mdcache));
+    mdcache->strings = g_string_chunk_new (4096);
+    mdcache->dirs = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+            (GDestroyNotify) g_hash_table_unref);
+    return mdcache;
+}
+
+mdcache_t *
+mdcache_load (void)
+{
+    mdcache_t *mdcache;
+    gsize len;
+    char *s, *end;
+    char *fields[NB_FIELDS];
+    int i;
+
+    mdcache = mdcache_new ();
+    mdcache->file = g_build_filename (g_get_user_cache_dir (), "pkgclip",
+            "metadata", NULL);
+
+    if (!g_file_get_contents (mdcache->file, &mdcache->contents, &len, NULL))
+        return mdcache;
+
+    s = mdcache->contents;
+    end = s + len;
+    if (g_strcmp0 (next_field (&s, end), MDCACHE_MAGIC) != 0)
+        return mdcache;
+
+    for (;;)
+    {
+        mdcache_entry_t *entry;
+
+        for (i = 0; i < NB_FIELDS; ++i)
+            if (!(fields[i] = next_field (&s, end)))
+                return mdcache;
+
+        entry = g_new0 (mdcache_entry_t, 1);
+        entry->ino          = g_ascii_strtoull (fields[2], NULL, 10);
+        entry->size         = g_ascii_strtoull (fields[3], NULL, 10);
+        entry->mtime        = g_ascii_strtoll (fields[4], NULL, 10);
+        entry->mtime_nsec   = g_ascii_strtoll (fields[5], NULL, 10);
+        entry->name         = fields[6];
+        entry->version      = fields[7];
+        entry->desc         = fields[8];
+        entry->arch         = fields[9];
+        g_hash_table_replace (get_dir (mdcache, fields[0], TRUE), fields[1], entry);
+    }
+}
+
+static gboolean
+is_valid (mdcache_entry_t *entry, struct stat *statbuf)
+{
+    return entry->ino == (guint64) statbuf->st_ino
+        && entry->size == (guint64) statbuf->st_size
+        && entry->mtime == (gint64) statbuf->st_mtim.tv_sec
+        && entry->mtime_nsec == (gint64) statbuf->st_mtim.tv_nsec;
+}
+
+/* returns the cached entry for the file, if still valid (i.e. the file wasn't
+ * modified since) */
+mdcache_entry_t *
+mdcache_lookup (mdcache_t *mdcache, const char *cachedir, const char *filename,
+                struct stat *statbuf)
+{
+    GHashTable *dir;
+    mdcache_entry_t *entry;
+
+    dir = get_dir (mdcache, cachedir, FALSE);
+    if (!dir)
+        return NULL;
+    entry = g_hash_table_lookup (dir, filename);
+    if (!entry || !is_valid (entry, statbuf))
+        return NULL;
+    entry->seen = TRUE;
+    return entry;
+}
+
+mdcache_entry_t *
+mdcache_add (mdcache_t *mdcache, const char *cachedir, const char *filename,
+             struct stat *statbuf, const char *name, const char *version,
+             const char *desc, const char *arch)
+{
+    mdcache_entry_t *entry;
+
+    entry = g_new0 (mdcache_entry_t, 1);
+    entry->ino          = (guint64) statbuf->st_ino;
+    entry->size         = (guint64) statbuf->st_size;
+    entry->mtime        = (gint64) statbuf->st_mtim.tv_sec;
+    entry->mtime_nsec   = (gint64) statbuf->st_mtim.tv_nsec;
+    entry->name         = g_string_chunk_insert (mdcache->strings, name);
+    entry->version      = g_string_chunk_insert (mdcache->strings, version);
+    entry->desc         = g_string_chunk_insert (mdcache->strings, (desc) ? desc : "");
+    entry->arch         = g_string_chunk_insert (mdcache->strings, (arch) ? arch : "");
+    entry->seen         = TRUE;
+    g_hash_table_replace (get_dir (mdcache, cachedir, TRUE),
+            g_string_chunk_insert (mdcache->strings, filename),
+            entry);
+    mdcache->dirty = TRUE;
+    return entry;
+}
+
+static gboolean
+not_seen (gpointer key _UNUSED_, mdcache_entry_t *entry, gpointer data _UNUSED_)
+{
+    return !entry->seen;
+}
+
+/* to be called once cachedir has been fully scanned: drops all entries for
+ * files that weren't found */
+void
+mdcache_prune (mdcache_t *mdcache, const char *cachedir)
+{
+    GHashTable *dir;
+
+    dir = get_dir (mdcache, cachedir, FALSE);
+    if (dir && g_hash_table_foreach_remove (dir, (GHRFunc) not_seen, NULL) > 0)
+        mdcache->dirty = TRUE;
+}
+
+static void
+append_field (GString *str, const char *field)
+{
+    g_string_append_len (str, field, (gssize) strlen (field) + 1);
+}
+
+static void
+append_number (GString *str, gint64 nb)
+{
+    char buf[23];
+
+    snprintf (buf, 23, "%" G_GINT64_FORMAT, nb);
+    append_field (str, buf);
+}
+
+gboolean
+mdcache_save (mdcache_t *mdcache)
+{
+    GHashTableIter iter_dirs, iter;
+    const char *cachedir, *filename;
+    GHashTable *dir;
+    mdcache_entry_t *entry;
+    GString *str;
+    gchar *path;
+    gboolean ret;
+
+    if (!mdcache->dirty || !mdcache->file)
+        return TRUE;
+
+    path = g_path_get_dirname (mdcache->file);
+    g_mkdir_with_parents (path, 0700);
+    g_free (path);
+
+    str = g_string_sized_new (1024 * 1024);
+    append_field (str, MDCACHE_MAGIC);
+    g_hash_table_iter_init (&iter_dirs, mdcache->dirs);
+    while (g_hash_table_iter_next (&iter_dirs, (gpointer *) &cachedir, (gpointer *) &dir))
+    {
+        g_hash_table_iter_init (&iter, dir);
+        while (g_hash_table_iter_next (&iter, (gpointer *) &filename, (gpointer *) &entry))
+        {
+            append_field (str, cachedir);
+            append_field (str, filename);
+            append_number (str, (gint64) entry->ino);
+            append_number (str, (gint64) entry->size);
+            append_number (str, entry->mtime);
+            append_number (str, entry->mtime_nsec);
+            append_field (str, entry->name);
+            append_field (str, entry->version);
+            append_field (str, entry->desc);
+            append_field (str, entry->arch);
+        }
+    }
+
+    ret = g_file_set_contents (mdcache->file, str->str, (gssize) str->len, NULL);
+    g_string_free (str, TRUE);
+    if (ret)
+        mdcache->dirty = FALSE;
+    return ret;
+}
+
+void
+mdcache_free (mdcache_t *mdcache)
+{
+    g_hash_table_unref (mdcache->dirs);
+    g_string_chunk_free (mdcache->strings);
+    g_free (mdcache->contents);
+    g_free (mdcache->file);
+    free (mdcache);
+}
@@ -0,0 +1,62 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * mdcache.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef _PKGCLIP_MDCACHE_H
+#define _PKGCLIP_MDCACHE_H
+
+#define MDCACHE_MAGIC   "PkgClip metadata cache 1"
+
+struct stat;
+
+typedef struct _mdcache_entry_t {
+    const char  *name;
+    const char  *version;
+    const char  *desc;
+    const char  *arch;
+    guint64      ino;
+    guint64      size;
+    gint64       mtime;
+    gint64       mtime_nsec;
+    gboolean     seen;
+} mdcache_entry_t;
+
+typedef struct _mdcache_t {
+    char         *file;
+    char         *contents;
+    GStringChunk *strings;
+    GHashTable   *dirs;
+    gboolean      dirty;
+} mdcache_t;
+
+mdcache_t * mdcache_new (void);
+mdcache_t * mdcache_load (void);
+mdcache_entry_t * mdcache_lookup (mdcache_t *mdcache, const char *cachedir,
+                                  const char *filename, struct stat *statbuf);
+mdcache_entry_t * mdcache_add (mdcache_t *mdcache, const char *cachedir,
+                               const char *filename, struct stat *statbuf,
+                               const char *name, const char *version,
+                               const char *desc, const char *arch);
+void mdcache_prune (mdcache_t *mdcache, const char *cachedir);
+gboolean mdcache_save (mdcache_t *mdcache);
+void mdcache_free (mdcache_t *mdcache);
+
+#endif /* _PKGCLIP_MDCACHE_H */
@@ -1,4 +1,4 @@
 [D-BUS Service]
 Name=org.jjk.PkgClip
-Exec=@BINDIR@/pkgclip-dbus
+Exec=@BINDIR@/pkgclip-dbus --persistent
 User=root
@@ -0,0 +1,36 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * pkgclip-cli.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+/* pkgclip */
+#include "common.h"
+#include "cli.h"
+
+/* Same as pkgclip's headless mode, but without the GUI: only needs GLib/GIO
+ * and libalpm, so it can be installed on machines without GTK+. */
+
+int
+main (int argc, char *argv[])
+{
+    return run_headless (argc, argv);
+}
@@ -27,12 +27,17 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <glob.h>
 
 /* PolicyKit */
 #include <polkit/polkit.h>
 
 /* gio - for dbus */
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 
 #define _UNUSED_                __attribute__ ((unused))
 
@@ -42,55 +47,713 @@ static GDBusNodeInfo *introspection_data = NULL;
 static const gchar introspection_xml[] =
   "<node>"
   "  <interface name='org.jjk.PkgClip.ClipperInterface'>"
-  "    <method name='RemovePackages'>"
-  "      <arg type='as' name='packages'   direction='in'/>"
+  "    <method name='BeginRemoval'>"
+  "      <arg type='as' name='cachedirs'  direction='in'/>"
+  "    </method>"
+  "    <method name='AddEntries'>"
+  "      <arg type='a(us)' name='entries' direction='in'/>"
+  "    </method>"
+  "    <method name='AddEntriesFromFd'>"
+  "      <arg type='h'  name='fd'         direction='in'/>"
+  "    </method>"
+  "    <method name='Commit'>"
   "      <arg type='i'  name='processed'  direction='out'/>"
   "    </method>"
-  "    <signal name='RemoveSuccess'>"
-  "      <arg type='s' name='package' />"
-  "    </signal>"
-  "    <signal name='RemoveFailure'>"
-  "      <arg type='s' name='package' />"
-  "      <arg type='s' name='error' />"
+  "    <method name='Cancel'>"
+  "    </method>"
+  "    <signal name='RemoveProgress'>"
+  "      <arg type='a(sis)' name='results' />"
   "    </signal>"
   "  </interface>"
   "</node>";
 
 static GMainLoop *loop;
 
+/* how many files can be removed at once */
+#define DEFAULT_JOBS            4
+static gint jobs = DEFAULT_JOBS;
+
+/* results are sent in batches, whenever we have that many of them or that much
+ * time (in microseconds) has passed since the last batch was sent; a timeout
+ * makes sure of the latter even if no more results come in */
+#define BATCH_MAX_FILES         512
+#define BATCH_MAX_TIME          (100 * 1000)
+
+typedef struct _batch_t {
+    GDBusConnection *connection;
+    const gchar     *sender;
+    const gchar     *object_path;
+    const gchar     *interface_name;
+    GMutex           mutex;
+    GVariantBuilder  builder;
+    guint            nb;
+    gint64           last_sent;
+    /* timeout (on the main context) while results are pending */
+    guint            timeout_id;
+} batch_t;
+
 static void
-handle_method_call (GDBusConnection       *connection,
-                    const gchar           *sender,
-                    const gchar           *object_path,
-                    const gchar           *interface_name,
-                    const gchar           *method_name,
-                    GVariant              *parameters,
-                    GDBusMethodInvocation *invocation,
-                    gpointer               data _UNUSED_)
+batch_init (batch_t         *batch,
+            GDBusConnection *connection,
+            const gchar     *sender,
+            const gchar     *object_path,
+            const gchar     *interface_name)
 {
-    /* only one method we support */
-    if (g_strcmp0 (method_name, "RemovePackages") != 0)
-        return;
+    batch->connection = connection;
+    batch->sender = sender;
+    batch->object_path = object_path;
+    batch->interface_name = interface_name;
+    g_mutex_init (&batch->mutex);
+    g_variant_builder_init (&batch->builder, G_VARIANT_TYPE ("a(sis)"));
+    batch->nb = 0;
+    batch->last_sent = g_get_monotonic_time ();
+    batch->timeout_id = 0;
+}
 
-    /* first off, check auth */
+static void
+batch_flush (batch_t *batch)
+{
     GError *error = NULL;
-    PolkitAuthority *authority;
-    PolkitSubject *subject;
-    PolkitAuthorizationResult *result;
 
-    authority = polkit_authority_get_sync (NULL, NULL);
-    subject = polkit_system_bus_name_new (sender);
-    result = polkit_authority_check_authorization_sync (
-            authority,
-            subject, 
-            "org.jjk.pkgclip.removepkgs",
+    if (batch->nb == 0)
+        return;
+
+    g_dbus_connection_emit_signal (batch->connection,
+            batch->sender,
+            batch->object_path,
+            batch->interface_name,
+            "RemoveProgress",
+            g_variant_new ("(a(sis))", &batch->builder),
+            &error);
+    g_assert_no_error (error);
+
+    /* builder was cleared, get it ready for the next batch */
+    g_variant_builder_init (&batch->builder, G_VARIANT_TYPE ("a(sis)"));
+    batch->nb = 0;
+    batch->last_sent = g_get_monotonic_time ();
+}
+
+static gboolean
+batch_timeout (batch_t *batch)
+{
+    g_mutex_lock (&batch->mutex);
+    batch_flush (batch);
+    batch->timeout_id = 0;
+    g_mutex_unlock (&batch->mutex);
+    return FALSE;
+}
+
+/* can be called from any thread. msg defaults to the error message for err */
+static void
+batch_add (batch_t *batch, const gchar *pkg, gint err, const gchar *msg)
+{
+    g_mutex_lock (&batch->mutex);
+    g_variant_builder_add (&batch->builder, "(sis)", pkg, err,
+            (msg) ? msg : (err) ? g_strerror (err) : "");
+    if (++batch->nb >= BATCH_MAX_FILES
+            || g_get_monotonic_time () - batch->last_sent >= BATCH_MAX_TIME)
+        batch_flush (batch);
+    else if (batch->timeout_id == 0)
+        /* in case this was the last one for a while */
+        batch->timeout_id = g_timeout_add (BATCH_MAX_TIME / 1000,
+                (GSourceFunc) batch_timeout, batch);
+    g_mutex_unlock (&batch->mutex);
+}
+
+/* must be called from the main context */
+static void
+batch_clear (batch_t *batch)
+{
+    if (batch->timeout_id > 0)
+        g_source_remove (batch->timeout_id);
+    g_variant_builder_clear (&batch->builder);
+    g_mutex_clear (&batch->mutex);
+}
+
+/* In persistent mode, we don't exit after a call but stay around until we've
+ * been idle for idle_timeout seconds. Authorizations are then also kept for as
+ * long as the caller stays connected, so it isn't asked again for each call.
+ */
+
+static gboolean persistent = FALSE;
+#define DEFAULT_IDLE_TIMEOUT    120
+static gint idle_timeout = DEFAULT_IDLE_TIMEOUT;
+static guint idle_id = 0;
+static guint nb_calls = 0;
+
+static PolkitAuthority *authority = NULL;
+/* unique bus name -> watcher id */
+static GHashTable *authorized = NULL;
+
+static gboolean
+idle_timeout_cb (gpointer data _UNUSED_)
+{
+    idle_id = 0;
+    g_main_loop_quit (loop);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+call_start (void)
+{
+    ++nb_calls;
+    if (idle_id > 0)
+    {
+        g_source_remove (idle_id);
+        idle_id = 0;
+    }
+}
+
+static void
+call_done (void)
+{
+    if (--nb_calls > 0)
+        return;
+    if (!persistent)
+        /* we have no reason to keep running at this point */
+        g_main_loop_quit (loop);
+    else if (idle_id == 0)
+        idle_id = g_timeout_add_seconds ((guint) idle_timeout, idle_timeout_cb, NULL);
+}
+
+static void
+on_name_vanished (GDBusConnection *connection _UNUSED_,
+                  const gchar     *name,
+                  gpointer         user_data _UNUSED_)
+{
+    guint watcher_id;
+
+    watcher_id = GPOINTER_TO_UINT (g_hash_table_lookup (authorized, name));
+    g_hash_table_remove (authorized, name);
+    if (watcher_id > 0)
+        g_bus_unwatch_name (watcher_id);
+}
+
+static void
+set_authorized (GDBusConnection *connection, const gchar *sender)
+{
+    guint watcher_id;
+
+    if (!persistent || g_hash_table_contains (authorized, sender))
+        return;
+    /* so we can forget about it once it's gone */
+    watcher_id = g_bus_watch_name_on_connection (connection,
+            sender,
+            G_BUS_NAME_WATCHER_FLAGS_NONE,
             NULL,
-            POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
+            on_name_vanished,
             NULL,
-            &error);
+            NULL);
+    g_hash_table_insert (authorized, g_strdup (sender), GUINT_TO_POINTER (watcher_id));
+}
+
+/* Removals are done within a session: BeginRemoval starts one for the caller
+ * (once authorized), declaring the cache directories files will be removed
+ * from. Each one is opened once, and AddEntries (or AddEntriesFromFd) then
+ * queues files to be removed, as an index into those and a file name. They're
+ * removed right away from a pool of threads, using unlinkat() on the cachedir.
+ * Commit waits for all files to have been processed and ends the session,
+ * replying with how many were. Cancel makes it so no more files get removed
+ * (those being removed at the time are still reported), the session must still
+ * be ended with Commit.
+ *
+ * Only package files (and their signatures) directly within a cachedir can be
+ * removed: file names cannot contain a slash, so unlinkat() can't resolve
+ * anything outside of it. And the declared cachedirs must be ones from the
+ * CacheDir option of the system's pacman.conf (read by us, not the client):
+ * once opened, each one is compared (device & inode) with those; all entries
+ * for any other directory fail with EPERM.
+ */
+
+#define PACMAN_CONF             "/etc/pacman.conf"
+#define CACHE_PATH              "/var/cache/pacman/pkg/"
+
+typedef struct _dir_id_t {
+    dev_t        dev;
+    ino_t        ino;
+} dir_id_t;
+
+static void
+add_cachedir (GArray *cachedirs, const gchar *path)
+{
+    struct stat statbuf;
+    dir_id_t id;
+
+    if (stat (path, &statbuf) != 0 || !S_ISDIR (statbuf.st_mode))
+        return;
+    id.dev = statbuf.st_dev;
+    id.ino = statbuf.st_ino;
+    g_array_append_val (cachedirs, id);
+}
+
+/* only the CacheDir option (in [options], possibly from an included file)
+ * matters to us */
+static void
+parse_pacman_conf (const gchar  *file,
+                   gint          depth,
+                   gboolean     *in_options,
+                   gboolean     *found,
+                   GArray       *cachedirs)
+{
+    gchar *contents;
+    gchar **lines, **l;
+
+    if (!g_file_get_contents (file, &contents, NULL, NULL))
+        return;
+    lines = g_strsplit (contents, "\n", -1);
+    g_free (contents);
+
+    for (l = lines; *l; ++l)
+    {
+        gchar *key = *l;
+        gchar *value;
+        gchar *s;
+
+        if ((s = strchr (key, '#')))
+            *s = '\0';
+        g_strstrip (key);
+        if (*key == '[')
+        {
+            *in_options = (strcmp (key, "[options]") == 0);
+            continue;
+        }
+        if (!(value = strchr (key, '=')))
+            continue;
+        *value++ = '\0';
+        g_strstrip (key);
+        g_strstrip (value);
+
+        if (strcmp (key, "Include") == 0 && depth < 10)
+        {
+            glob_t globbuf;
+            size_t i;
+
+            if (glob (value, 0, NULL, &globbuf) == 0)
+                for (i = 0; i < globbuf.gl_pathc; ++i)
+                    parse_pacman_conf (globbuf.gl_pathv[i], depth + 1,
+                            in_options, found, cachedirs);
+            globfree (&globbuf);
+        }
+        else if (*in_options && strcmp (key, "CacheDir") == 0)
+        {
+            gchar **dirs, **d;
+
+            dirs = g_strsplit_set (value, " \t", -1);
+            for (d = dirs; *d; ++d)
+                if (**d != '\0')
+                {
+                    add_cachedir (cachedirs, *d);
+                    *found = TRUE;
+                }
+            g_strfreev (dirs);
+        }
+    }
+    g_strfreev (lines);
+}
+
+/* returns the cachedirs files can be removed from, as dir_id_t */
+static GArray *
+get_cachedirs (void)
+{
+    GArray *cachedirs;
+    gboolean in_options = FALSE;
+    gboolean found = FALSE;
+
+    cachedirs = g_array_new (FALSE, FALSE, sizeof (dir_id_t));
+    parse_pacman_conf (PACMAN_CONF, 0, &in_options, &found, cachedirs);
+    if (!found)
+        add_cachedir (cachedirs, CACHE_PATH);
+    return cachedirs;
+}
+
+static gboolean
+is_cachedir (GArray *cachedirs, int fd)
+{
+    struct stat statbuf;
+    guint i;
+
+    if (fstat (fd, &statbuf) != 0)
+        return FALSE;
+    for (i = 0; i < cachedirs->len; ++i)
+    {
+        dir_id_t *id = &g_array_index (cachedirs, dir_id_t, i);
+
+        if (id->dev == statbuf.st_dev && id->ino == statbuf.st_ino)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+typedef struct _rm_dir_t {
+    int          fd;
+    int          err;
+    gchar       *path;
+} rm_dir_t;
+
+typedef struct _session_t {
+    gchar                   *sender;
+    gchar                   *object_path;
+    gchar                   *interface_name;
+    batch_t                  batch;
+    /* cachedirs, as rm_dir_t */
+    GPtrArray               *dirs;
+    GThreadPool             *pool;
+    guint                    watcher_id;
+    gint                     cancelled;
+    gint                     processed;
+    gboolean                 committed;
+    GDBusMethodInvocation   *invocation;
+} session_t;
+
+typedef struct _rm_job_t {
+    rm_dir_t    *dir;
+    const gchar *name;
+    /* cachedir + name, used to report results */
+    gchar        path[];
+} rm_job_t;
+
+/* unique bus name -> session_t */
+static GHashTable *sessions = NULL;
+/* unique bus names whose BeginRemoval is waiting for authorization */
+static GHashTable *pending = NULL;
+
+static void
+free_rm_dir (rm_dir_t *dir)
+{
+    if (dir->fd >= 0)
+        close (dir->fd);
+    g_free (dir->path);
+    g_free (dir);
+}
+
+static void
+rm_job (rm_job_t *job, session_t *session)
+{
+    int err;
+
+    if (!g_atomic_int_get (&session->cancelled))
+    {
+        if (job->dir->fd < 0)
+            err = job->dir->err;
+        else
+            err = (unlinkat (job->dir->fd, job->name, 0) == 0) ? 0 : errno;
+        g_atomic_int_inc (&session->processed);
+        batch_add (&session->batch, job->path, err, NULL);
+    }
+    g_free (job);
+}
+
+static void
+free_session (session_t *session)
+{
+    if (session->watcher_id > 0)
+        g_bus_unwatch_name (session->watcher_id);
+    if (session->pool)
+        g_thread_pool_free (session->pool, TRUE, TRUE);
+    g_ptr_array_unref (session->dirs);
+    batch_clear (&session->batch);
+    g_free (session->sender);
+    g_free (session->object_path);
+    g_free (session->interface_name);
+    g_free (session);
+}
+
+static void session_commit (session_t *session, GDBusMethodInvocation *invocation);
+
+static void
+on_session_vanished (GDBusConnection *connection _UNUSED_,
+                     const gchar     *name,
+                     gpointer         user_data _UNUSED_)
+{
+    session_t *session;
+
+    session = g_hash_table_lookup (sessions, name);
+    if (!session)
+        return;
+    /* nobody to report to anymore */
+    g_atomic_int_set (&session->cancelled, 1);
+    if (!session->committed)
+        session_commit (session, NULL);
+}
+
+static session_t *
+session_new (GDBusMethodInvocation *invocation)
+{
+    session_t *session;
+    GVariantIter *iter;
+    const gchar *cachedir;
+    GArray *cachedirs;
+
+    session = g_new0 (session_t, 1);
+    session->sender = g_strdup (g_dbus_method_invocation_get_sender (invocation));
+    session->object_path = g_strdup (g_dbus_method_invocation_get_object_path (invocation));
+    session->interface_name = g_strdup (g_dbus_method_invocation_get_interface_name (invocation));
+    batch_init (&session->batch,
+            g_dbus_method_invocation_get_connection (invocation),
+            session->sender,
+            session->object_path,
+            session->interface_name);
+    session->dirs = g_ptr_array_new_with_free_func ((GDestroyNotify) free_rm_dir);
+    session->pool = g_thread_pool_new ((GFunc) rm_job, session, jobs, TRUE, NULL);
+    session->watcher_id = g_bus_watch_name_on_connection (
+            g_dbus_method_invocation_get_connection (invocation),
+            session->sender,
+            G_BUS_NAME_WATCHER_FLAGS_NONE,
+            NULL,
+            on_session_vanished,
+            NULL,
+            NULL);
+    g_hash_table_insert (sessions, session->sender, session);
+
+    /* read each time, in case it changed */
+    cachedirs = get_cachedirs ();
+    g_variant_get (g_dbus_method_invocation_get_parameters (invocation),
+            "(as)", &iter);
+    while (g_variant_iter_next (iter, "&s", &cachedir))
+    {
+        rm_dir_t *dir;
+
+        dir = g_new0 (rm_dir_t, 1);
+        dir->path = g_strdup (cachedir);
+        if (*cachedir != '/')
+        {
+            dir->fd = -1;
+            dir->err = EINVAL;
+        }
+        else
+        {
+            dir->fd = open (cachedir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dir->fd < 0)
+                dir->err = errno;
+            else if (!is_cachedir (cachedirs, dir->fd))
+            {
+                close (dir->fd);
+                dir->fd = -1;
+                dir->err = EPERM;
+            }
+        }
+        g_ptr_array_add (session->dirs, dir);
+    }
+    g_variant_iter_free (iter);
+    g_array_unref (cachedirs);
+
+    return session;
+}
+
+static gboolean
+is_valid_name (const gchar *name, size_t len)
+{
+    /* must be a file within the cachedir, and a package file (or signature) */
+    return len > 0
+        && !memchr (name, '/', len)
+        && !(name[0] == '.' && (len == 1 || (len == 2 && name[1] == '.')))
+        && g_strstr_len (name, (gssize) len, ".pkg.tar");
+}
+
+static void
+session_add_entry (session_t *session, guint idx, const gchar *name, size_t len)
+{
+    rm_dir_t *dir;
+    rm_job_t *job;
+    size_t dlen;
+    gboolean slash;
+
+    if (idx >= session->dirs->len || !is_valid_name (name, len))
+    {
+        gchar *s = g_strndup (name, len);
+
+        /* invalid entries are processed (and failed) right away */
+        g_atomic_int_inc (&session->processed);
+        batch_add (&session->batch, s, EINVAL,
+                (idx >= session->dirs->len)
+                ? "Invalid cache directory"
+                : "Not a package file within the cache directory");
+        g_free (s);
+        return;
+    }
+
+    dir = g_ptr_array_index (session->dirs, idx);
+    dlen = strlen (dir->path);
+    slash = dlen > 0 && dir->path[dlen - 1] != '/';
+
+    job = g_malloc (sizeof (*job) + dlen + slash + len + 1);
+    memcpy (job->path, dir->path, dlen);
+    if (slash)
+        job->path[dlen] = '/';
+    memcpy (job->path + dlen + slash, name, len);
+    job->path[dlen + slash + len] = '\0';
+    job->dir = dir;
+    job->name = job->path + dlen + slash;
+    g_thread_pool_push (session->pool, job, NULL);
+}
+
+static void
+session_add_entries (session_t *session, GVariant *parameters)
+{
+    GVariantIter *iter;
+    const gchar *name;
+    guint32 idx;
+
+    g_variant_get (parameters, "(a(us))", &iter);
+    while (g_variant_iter_next (iter, "(u&s)", &idx, &name))
+        session_add_entry (session, idx, name, strlen (name));
+    g_variant_iter_free (iter);
+}
+
+/* the memfd must be sealed, so it can't change under us while it's mapped */
+#define REQUIRED_SEALS          (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+
+/* entries are read from a (sealed) memfd, each one being the cachedir index (in
+ * decimal) and the file name, separated by a slash, and NUL-terminated; so huge
+ * lists don't have to go through the bus */
+static gboolean
+session_add_entries_from_fd (session_t              *session,
+                             GDBusMethodInvocation  *invocation,
+                             GError                **error)
+{
+    GUnixFDList *fd_list;
+    gint32 h;
+    int fd;
+    int seals;
+    struct stat statbuf;
+    char *map, *s, *e, *end;
+
+    fd_list = g_dbus_message_get_unix_fd_list (
+            g_dbus_method_invocation_get_message (invocation));
+    if (!fd_list)
+    {
+        g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                "No file descriptor received");
+        return FALSE;
+    }
+    g_variant_get (g_dbus_method_invocation_get_parameters (invocation),
+            "(h)", &h);
+    fd = g_unix_fd_list_get (fd_list, h, error);
+    if (fd < 0)
+        return FALSE;
+
+    seals = fcntl (fd, F_GET_SEALS);
+    if (seals < 0 || (seals & REQUIRED_SEALS) != REQUIRED_SEALS)
+    {
+        close (fd);
+        g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                "File descriptor must be a sealed memfd");
+        return FALSE;
+    }
+    if (fstat (fd, &statbuf) < 0)
+    {
+        int _errno = errno;
+        close (fd);
+        g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                "Unable to stat file descriptor: %s", g_strerror (_errno));
+        return FALSE;
+    }
+    if (statbuf.st_size == 0)
+    {
+        close (fd);
+        return TRUE;
+    }
+
+    map = mmap (NULL, (size_t) statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+    {
+        g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                "Unable to map file descriptor: %s", g_strerror (errno));
+        return FALSE;
+    }
+
+    end = map + statbuf.st_size;
+    for (s = map; s < end; s = e + 1)
+    {
+        guint idx = 0;
+        char *n;
+
+        e = memchr (s, '\0', (size_t) (end - s));
+        if (!e)
+            e = end;
+        if (e == s)
+            continue;
+
+        for (n = s; n < e && *n >= '0' && *n <= '9'; ++n)
+            idx = idx * 10 + (guint) (*n - '0');
+        if (n == s || n == e || *n != '/' || n - s > 9)
+            /* invalid index */
+            idx = G_MAXUINT;
+        else
+            ++n;
+        session_add_entry (session, idx, n, (size_t) (e - n));
+    }
+    munmap (map, (size_t) statbuf.st_size);
+    return TRUE;
+}
+
+static void
+wait_session (GTask        *task,
+              gpointer      source _UNUSED_,
+              session_t    *session,
+              GCancellable *cancellable _UNUSED_)
+{
+    /* wait for all jobs to be done */
+    g_thread_pool_free (session->pool, FALSE, TRUE);
+    session->pool = NULL;
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+session_done (GObject *source _UNUSED_, GAsyncResult *res _UNUSED_, session_t *session)
+{
+    /* send what's left before returning, so all results are in before the
+     * reply */
+    batch_flush (&session->batch);
+    if (session->invocation)
+        g_dbus_method_invocation_return_value (session->invocation,
+                g_variant_new ("(i)", g_atomic_int_get (&session->processed)));
+    /* also frees it */
+    g_hash_table_remove (sessions, session->sender);
+    call_done ();
+}
+
+/* invocation can be NULL when there's no one to reply to */
+static void
+session_commit (session_t *session, GDBusMethodInvocation *invocation)
+{
+    GTask *task;
+
+    session->committed = TRUE;
+    session->invocation = invocation;
+    /* wait for the pool from another thread, so we can still process a Cancel
+     * meanwhile */
+    task = g_task_new (NULL, NULL, (GAsyncReadyCallback) session_done, session);
+    g_task_set_task_data (task, session, NULL);
+    g_task_run_in_thread (task, (GTaskThreadFunc) wait_session);
+    g_object_unref (task);
+}
+
+static void
+begin_removal (GDBusMethodInvocation *invocation)
+{
+    set_authorized (g_dbus_method_invocation_get_connection (invocation),
+            g_dbus_method_invocation_get_sender (invocation));
+    session_new (invocation);
+    g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static void
+check_authorization_cb (PolkitAuthority       *auth,
+                        GAsyncResult          *res,
+                        GDBusMethodInvocation *invocation)
+{
+    GError *error = NULL;
+    PolkitAuthorizationResult *result;
+
+    g_hash_table_remove (pending, g_dbus_method_invocation_get_sender (invocation));
+    result = polkit_authority_check_authorization_finish (auth, res, &error);
     if (result == NULL)
     {
         g_dbus_method_invocation_return_gerror (invocation, error);
+        g_error_free (error);
+        call_done ();
         return;
     }
     if (!polkit_authorization_result_get_is_authorized (result))
@@ -100,48 +763,122 @@ handle_method_call (GDBusConnection       *connection,
                 invocation,
                 "org.jjk.PkgClip.AuthError",
                 "Authorization from PolicyKit failed");
+        call_done ();
         return;
     }
     g_object_unref (result);
 
     /* ok, now do the work */
-    GVariantIter *iter;
-    const gchar *pkg;
-    guint processed = 0;
+    begin_removal (invocation);
+}
 
-    g_variant_get (parameters, "(as)", &iter);
-    while (g_variant_iter_loop (iter, "s", &pkg))
+static void
+handle_method_call (GDBusConnection       *connection _UNUSED_,
+                    const gchar           *sender,
+                    const gchar           *object_path _UNUSED_,
+                    const gchar           *interface_name _UNUSED_,
+                    const gchar           *method_name,
+                    GVariant              *parameters,
+                    GDBusMethodInvocation *invocation,
+                    gpointer               data _UNUSED_)
+{
+    session_t *session;
+
+    session = g_hash_table_lookup (sessions, sender);
+
+    if (g_strcmp0 (method_name, "AddEntries") == 0
+            || g_strcmp0 (method_name, "AddEntriesFromFd") == 0
+            || g_strcmp0 (method_name, "Commit") == 0
+            || g_strcmp0 (method_name, "Cancel") == 0)
     {
-        ++processed;
-        if (unlink (pkg) == 0)
+        if (!session || session->committed)
+        {
+            g_dbus_method_invocation_return_dbus_error (
+                    invocation,
+                    "org.jjk.PkgClip.NoSession",
+                    "No removal in progress");
+            return;
+        }
+
+        if (g_strcmp0 (method_name, "AddEntries") == 0)
         {
-            g_dbus_connection_emit_signal (connection,
-                    sender,
-                    object_path,
-                    interface_name,
-                    "RemoveSuccess",
-                    g_variant_new ("(s)", pkg),
-                    &error);
-            g_assert_no_error (error);
+            session_add_entries (session, parameters);
+            g_dbus_method_invocation_return_value (invocation, NULL);
         }
+        else if (g_strcmp0 (method_name, "AddEntriesFromFd") == 0)
+        {
+            GError *error = NULL;
+
+            if (session_add_entries_from_fd (session, invocation, &error))
+                g_dbus_method_invocation_return_value (invocation, NULL);
+            else
+            {
+                g_dbus_method_invocation_return_gerror (invocation, error);
+                g_error_free (error);
+            }
+        }
+        else if (g_strcmp0 (method_name, "Commit") == 0)
+            session_commit (session, invocation);
         else
         {
-            g_dbus_connection_emit_signal (connection,
-                    sender,
-                    object_path,
-                    interface_name,
-                    "RemoveFailure",
-                    g_variant_new ("(ss)", pkg, strerror (errno)),
-                    &error);
-            g_assert_no_error (error);
+            g_atomic_int_set (&session->cancelled, 1);
+            g_dbus_method_invocation_return_value (invocation, NULL);
         }
+        return;
     }
-    g_variant_iter_free (iter);
 
-    g_dbus_method_invocation_return_value (invocation,
-            g_variant_new ("(i)", processed));
-    /* we have no reason to keep running at this point */
-    g_main_loop_quit (loop);
+    if (g_strcmp0 (method_name, "BeginRemoval") != 0)
+        return;
+
+    /* one removal per client; that includes while it's being authorized */
+    if (session || g_hash_table_contains (pending, sender))
+    {
+        g_dbus_method_invocation_return_dbus_error (
+                invocation,
+                "org.jjk.PkgClip.Busy",
+                "A removal is already in progress");
+        return;
+    }
+
+    /* session lasts until committed */
+    call_start ();
+
+    /* already authorized during this session */
+    if (persistent && g_hash_table_contains (authorized, sender))
+    {
+        begin_removal (invocation);
+        return;
+    }
+
+    /* first off, check auth. This is done asynchronously, so we can still
+     * serve other calls while the user is being prompted */
+    GError *error = NULL;
+    PolkitSubject *subject;
+
+    if (!authority)
+    {
+        authority = polkit_authority_get_sync (NULL, &error);
+        if (!authority)
+        {
+            g_dbus_method_invocation_return_gerror (invocation, error);
+            g_error_free (error);
+            call_done ();
+            return;
+        }
+    }
+
+    g_hash_table_add (pending, g_strdup (sender));
+    subject = polkit_system_bus_name_new (sender);
+    polkit_authority_check_authorization (
+            authority,
+            subject,
+            "org.jjk.pkgclip.removepkgs",
+            NULL,
+            POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
+            NULL,
+            (GAsyncReadyCallback) check_authorization_cb,
+            invocation);
+    g_object_unref (subject);
 }
 
 static void
@@ -182,9 +919,40 @@ on_name_lost (GDBusConnection *connection _UNUSED_,
 }
 
 int
-main (int argc _UNUSED_, char *argv[] _UNUSED_)
+main (int argc, char *argv[])
 {
   guint owner_id;
+  GOptionContext *context;
+  GError *error = NULL;
+  GOptionEntry entries[] = {
+      { "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+          "Number of files to remove in parallel (default: 4)", "N" },
+      { "persistent", 'p', 0, G_OPTION_ARG_NONE, &persistent,
+          "Keep running after a call, until idle", NULL },
+      { "idle-timeout", 't', 0, G_OPTION_ARG_INT, &idle_timeout,
+          "Seconds to stay idle before exiting, in persistent mode (default: 120)",
+          "SECONDS" },
+      { NULL, 0, 0, 0, NULL, NULL, NULL }
+  };
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+  {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      g_clear_error (&error);
+      g_option_context_free (context);
+      return 1;
+  }
+  g_option_context_free (context);
+  if (jobs < 1)
+      jobs = 1;
+  if (idle_timeout < 1)
+      idle_timeout = 1;
+  authorized = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  sessions = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+          (GDestroyNotify) free_session);
+  pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
   /* We are lazy here - we don't want to manually provide
    * the introspection data structures - so we just build
@@ -203,9 +971,17 @@ main (int argc _UNUSED_, char *argv[] _UNUSED_)
                              NULL);
 
   loop = g_main_loop_new (NULL, FALSE);
+  /* don't stay around forever if no call ever comes */
+  if (persistent)
+      idle_id = g_timeout_add_seconds ((guint) idle_timeout, idle_timeout_cb, NULL);
   g_main_loop_run (loop);
 
   g_bus_unown_name (owner_id);
+  g_hash_table_unref (sessions);
+  g_hash_table_unref (pending);
+  g_hash_table_unref (authorized);
+  if (authority)
+      g_object_unref (authority);
   g_dbus_node_info_unref (introspection_data);
   return 0;
 }
@@ -26,25 +26,8 @@
 /* gtk */
 #include <gtk/gtk.h>
 
-/* gio - for dbus */
-#include <gio/gio.h>
-
-/* alpm */
-#include <alpm.h>
-#include <alpm_list.h>
-
-#if defined(GIT_VERSION)
-#undef PACKAGE_VERSION
-#define PACKAGE_VERSION GIT_VERSION
-#endif
-#define PACKAGE_TAG             "Cached Packages Trimmer Utility"
-
-#define PACMAN_CONF             "/etc"
-#define ROOT_PATH               "/"
-#define DB_PATH                 "/var/lib/pacman/"
-#define CACHE_PATH              "/var/cache/pacman/pkg/"
-
-#define _UNUSED_                __attribute__ ((unused)) 
+/* pkgclip */
+#include "common.h"
 
 typedef enum {
     COL_PC_PKG,
@@ -59,22 +42,6 @@ typedef enum {
     COL_NB
 } col_t;
 
-typedef enum {
-    RECOMM_KEEP,
-    RECOMM_REMOVE
-} recomm_t;
-
-typedef enum {
-    REASON_AS_INSTALLED,
-    REASON_NEWER_THAN_INSTALLED,
-    REASON_INSTALLED,
-    REASON_OLDER_VERSION,
-    REASON_ALREADY_OLDER_VERSION,
-    REASON_OLDER_PKGREL,
-    REASON_PKG_NOT_INSTALLED,
-    NB_REASONS
-} reason_t;
-
 typedef enum {
     MARK_SELECTION,
     UNMARK_SELECTION,
@@ -83,10 +50,28 @@ typedef enum {
     SELECT_RESTORE
 } mark_t;
 
+typedef struct _remove_error_t {
+    const char  *path;
+    int          err;
+    const char  *message;
+} remove_error_t;
+
 typedef struct _progress_win_t {
     GtkWidget   *window;
     GtkWidget   *label;
     GtkWidget   *pbar;
+    GtkWidget   *btn_cancel;
+
+    /* files to remove, sent in chunks */
+    GPtrArray   *paths;
+    guint        next;
+    /* files not yet processed (keys from paths) */
+    GHashTable  *pending;
+    gboolean     begun;
+    gboolean     cancelled;
+    /* set when paths could not be sent, with the first error */
+    gboolean     failed;
+    char        *error;
 
     unsigned int total_files;
     unsigned int success_files;
@@ -94,9 +79,9 @@ typedef struct _progress_win_t {
     unsigned int error_files;
     off_t        error_size;
 
-    char        *error_messages;
-    unsigned int em_alloc;
-    unsigned int em_len;
+    /* remove_error_t, strings from the chunk (messages are shared) */
+    GArray       *errors;
+    GStringChunk *strings;
 } progress_win_t;
 
 typedef struct _prefs_win_t {
@@ -105,6 +90,8 @@ typedef struct _prefs_win_t {
     GtkWidget    *entry;
     GtkWidget    *chk_old_pkgrel;
     GtkWidget    *chk_autoload;
+    GtkWidget    *chk_fast_scan;
+    GtkWidget    *chk_watch_cache;
     GtkWidget    *chk_show_pkg_info;
     GtkWidget    *entry_pkg_info;
     GtkWidget    *chk_remove_sig;
@@ -116,77 +103,5 @@ typedef struct _prefs_win_t {
     char         *pkg_info;
 } prefs_win_t;
 
-typedef enum {
-    VAR_NAME,
-    VAR_DESC,
-    VAR_VERSION,
-    VAR_FILE,
-    VAR_SIZE,
-    VAR_RECOMM,
-    VAR_REASON,
-} info_var_t;
-
-typedef struct _pkgclip_t {
-    /* config */
-    char            *pacmanconf;
-    char            *dbpath;
-    char            *rootpath;
-    alpm_list_t     *cachedirs;
-    gboolean         autoload;
-    gboolean         old_pkgrel;
-    recomm_t         recomm[NB_REASONS];
-    int              nb_old_ver;
-    alpm_list_t     *as_installed;
-    int              nb_old_ver_ai;
-    gboolean         show_pkg_info;
-    char            *pkg_info;
-    alpm_list_t     *pkg_info_extras;
-    gboolean         remove_sig;
-
-    /* app/gui */
-    gboolean         in_gtk_main;
-    gboolean         is_loading;
-    gboolean         abort;
-    GtkWidget       *window;
-    GtkListStore    *store;
-    GtkWidget       *list;
-    GtkWidget       *label;
-    GtkWidget       *button;
-    GtkWidget       *mnu_reload;
-    GtkWidget       *mnu_remove;
-    GtkWidget       *mnu_edit;
-    GtkWidget       *sep_pkg_info;
-    GtkWidget       *lbl_pkg_info;
-
-    gulong           handler_pkg_info;
-    GString         *str_info;
-
-    prefs_win_t     *prefs;
-
-    alpm_handle_t   *handle;
-    alpm_list_t     *packages;
-
-    unsigned int     total_packages;
-    off_t            total_size;
-    unsigned int     marked_packages;
-    off_t            marked_size;
-
-    gboolean         locked;
-    progress_win_t  *progress_win;
-
-    GDBusProxy      *proxy;
-} pkgclip_t;
-
-typedef struct _pc_pkg_t {
-    char *file;
-    off_t filesize;
-    alpm_pkg_t *pkg;
-    const char *name;
-    const char *version;
-    recomm_t recomm;
-    reason_t reason;
-    gboolean remove;
-} pc_pkg_t;
-
 
 #endif /* _PKGCLIP_H */
@@ -0,0 +1,876 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * scan.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+/* C */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/* pkgclip */
+#include "common.h"
+#include "util.h"
+#include "mdcache.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "scan.h"
+
+/* Everything needed to load packages from the cache directories and classify
+ * them, shared by the GUI and the headless mode; so nothing in here may use
+ * GTK.
+ */
+
+/* what we need of packages from the sync dbs, copied so workers don't have to
+ * use ALPM for it */
+typedef struct _sync_pkg_t {
+    const char  *name;
+    const char  *version;
+    const char  *desc;
+    const char  *arch;
+    off_t        size;
+} sync_pkg_t;
+
+typedef struct _sync_index_t {
+    /* filename -> sync_pkg_t */
+    GHashTable   *pkgs;
+    GStringChunk *strings;
+} sync_index_t;
+
+static void free_sync_index (sync_index_t *syncidx);
+
+int
+init_alpm (pkgclip_t *pkgclip)
+{
+    enum _alpm_errno_t err;
+
+    pkgclip->handle = alpm_initialize(pkgclip->rootpath, pkgclip->dbpath, &err);
+    if (!pkgclip->handle)
+    {
+        show_error ("Failed to initialize ALPM library", alpm_strerror (err),
+                pkgclip);
+        return -1;
+    }
+
+    alpm_list_t *i;
+    for (i = pkgclip->cachedirs; i; i = alpm_list_next (i))
+        alpm_option_add_cachedir (pkgclip->handle, i->data);
+
+    /* sync databases are only used to get info on packages, so no need to
+     * check signatures */
+    for (i = pkgclip->syncdbs; i; i = alpm_list_next (i))
+        alpm_register_syncdb (pkgclip->handle, i->data, 0);
+
+    return 0;
+}
+
+static void
+get_alpm_token (alpm_token_t *token, pkgclip_t *pkgclip)
+{
+    char path[PATH_MAX];
+    struct stat statbuf;
+
+    memset (token, 0, sizeof (*token));
+
+    snprintf (path, PATH_MAX, "%s/pacman.conf", pkgclip->pacmanconf);
+    if (stat (path, &statbuf) == 0)
+    {
+        token->conf_dev = (guint64) statbuf.st_dev;
+        token->conf_ino = (guint64) statbuf.st_ino;
+        token->conf_mtime = (gint64) statbuf.st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000)
+            + statbuf.st_mtim.tv_nsec;
+    }
+
+    /* each installed package has its own folder in there, so installing,
+     * upgrading or removing packages changes its mtime */
+    snprintf (path, PATH_MAX, "%s/local", pkgclip->dbpath);
+    if (stat (path, &statbuf) == 0)
+    {
+        token->local_mtime = (gint64) statbuf.st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000)
+            + statbuf.st_mtim.tv_nsec;
+        token->local_nlink = (guint64) statbuf.st_nlink;
+    }
+
+    /* sync dbs are written then renamed into place */
+    snprintf (path, PATH_MAX, "%s/sync", pkgclip->dbpath);
+    if (stat (path, &statbuf) == 0)
+        token->sync_mtime = (gint64) statbuf.st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000)
+            + statbuf.st_mtim.tv_nsec;
+}
+
+/* (re)initializes ALPM, unless pacman.conf and the databases didn't change since
+ * last time, so the handle (and its cache of the local db) as well as the
+ * snapshot can be kept. Returns what changed. Without a handle (first call, or
+ * a previous init failed, e.g. because of a broken pacman.conf) pacman.conf is
+ * always re-parsed, as there's nothing to compare against. */
+alpm_refresh_t
+refresh_alpm (pkgclip_t *pkgclip)
+{
+    alpm_token_t token;
+    alpm_refresh_t ret = REFRESH_NONE;
+
+    get_alpm_token (&token, pkgclip);
+    if (!pkgclip->handle || token.conf_dev != pkgclip->token.conf_dev
+            || token.conf_ino != pkgclip->token.conf_ino
+            || token.conf_mtime != pkgclip->token.conf_mtime)
+    {
+        /* re-parse it, dbpath might have changed as well */
+        free (pkgclip->dbpath);
+        pkgclip->dbpath = NULL;
+        free (pkgclip->rootpath);
+        pkgclip->rootpath = NULL;
+        FREELIST (pkgclip->cachedirs);
+        FREELIST (pkgclip->syncdbs);
+        parse_pacmanconf (pkgclip);
+        get_alpm_token (&token, pkgclip);
+        ret = REFRESH_CONF;
+    }
+    else if (token.local_mtime != pkgclip->token.local_mtime
+            || token.local_nlink != pkgclip->token.local_nlink
+            || token.sync_mtime != pkgclip->token.sync_mtime)
+        ret = REFRESH_DB;
+    else
+        return REFRESH_NONE;
+
+    if (pkgclip->handle)
+        alpm_release (pkgclip->handle);
+    pkgclip->handle = NULL;
+    /* it came from the sync dbs of that handle */
+    if (pkgclip->syncidx)
+    {
+        free_sync_index (pkgclip->syncidx);
+        pkgclip->syncidx = NULL;
+    }
+    if (pkgclip->snapshot)
+    {
+        snapshot_free (pkgclip->snapshot);
+        pkgclip->snapshot = NULL;
+    }
+    if (init_alpm (pkgclip) == 0)
+        pkgclip->token = token;
+    return ret;
+}
+
+int
+pc_pkg_cmp (const pc_pkg_t *pkg1, const pc_pkg_t *pkg2)
+{
+    int ret;
+
+    ret = strcmp (pkg1->name, pkg2->name);
+    if (ret == 0)
+        /* same package, compare version */
+        /* when ASC, we want pkg-2.0 first, then pkg-1.0 -- that way the most
+         * recent versions are first */
+        ret = 0 - pc_ver_cmp (&pkg1->ver, &pkg2->ver);
+    return ret;
+}
+
+/* for g_ptr_array_sort, which gives pointers to the elements */
+static int
+pc_pkg_ptr_cmp (const pc_pkg_t **pkg1, const pc_pkg_t **pkg2)
+{
+    return pc_pkg_cmp (*pkg1, *pkg2);
+}
+
+static void
+set_remove (pc_pkg_t *pc_pkg, gboolean remove, pkgclip_t *pkgclip)
+{
+    if (remove == pc_pkg->remove)
+        return;
+    pc_pkg->remove = remove;
+    if (remove)
+    {
+        ++(pkgclip->marked_packages);
+        pkgclip->marked_size += pc_pkg->filesize;
+    }
+    else
+    {
+        --(pkgclip->marked_packages);
+        pkgclip->marked_size -= pc_pkg->filesize;
+    }
+}
+
+/* classifies all versions of a package, i.e. packages from first to last
+ * (excluded). When reclassifying (i.e. changed is set), only packages whose
+ * recommendation changed are (un)marked, and changed is only called for those
+ * whose classification did change. */
+void
+classify_group (guint first, guint last, pkg_changed_fn changed, gpointer data,
+                pkgclip_t *pkgclip)
+{
+    gboolean reclassify = (changed != NULL);
+    pc_pkg_t *pc_pkg = g_ptr_array_index (pkgclip->packages, first);
+    const snapshot_pkg_t *pkg;
+    const pc_ver_t *inst_ver = NULL;
+    int old_ver = 0;
+    int nb_old_ver = pkgclip->nb_old_ver;
+    int is_installed = 0;
+    guint i;
+
+    /* is it installed? */
+    pkg = snapshot_get_installed (pkgclip->snapshot, pc_pkg->name);
+    if (NULL != pkg)
+    {
+        is_installed = 1;
+        inst_ver = &pkg->ver;
+    }
+
+    for (i = first; i < last; ++i)
+    {
+        reason_t reason;
+        recomm_t recomm;
+
+        pc_pkg = g_ptr_array_index (pkgclip->packages, i);
+
+        if (is_installed > 0)
+        {
+            int cmp = pc_ver_cmp (&pc_pkg->ver, inst_ver);
+            if (cmp == 0)
+                /* installed version */
+                reason = REASON_INSTALLED;
+            else if (cmp < 0)
+            {
+                /* older version, we only keep a certain amount */
+                ++old_ver;
+                /* not yet reached? */
+                if (old_ver <= nb_old_ver)
+                {
+                    /* but: should we check if it's not just an old pkgrel? */
+                    if (pkgclip->old_pkgrel)
+                    {
+                        if (pc_pkg->ver.has_pkgrel)
+                        {
+                            /* are they the same, pkgrel aside? */
+                            if (pc_ver_cmp_pkgver (&pc_pkg->ver, inst_ver) == 0)
+                            {
+                                /* same version, older pkgrel */
+                                --old_ver;
+                                reason = REASON_OLDER_PKGREL;
+                            }
+                            else
+                                /* older version */
+                                reason = REASON_OLDER_VERSION;
+                        }
+                        else
+                            /* no pkgrel, so it is an older version */
+                            reason = REASON_OLDER_VERSION;
+                    }
+                    else
+                        /* older version */
+                        reason = REASON_OLDER_VERSION;
+                }
+                else
+                    /* we already have our stock of old versions */
+                    reason = REASON_ALREADY_OLDER_VERSION;
+            }
+            else
+                /* newer than installed */
+                reason = REASON_NEWER_THAN_INSTALLED;
+        }
+        else if (snapshot_is_as_installed (pkgclip->snapshot, pc_pkg->name))
+        {
+            /* treat as if installed */
+            reason = REASON_AS_INSTALLED;
+            is_installed = 2;
+            nb_old_ver = pkgclip->nb_old_ver_ai;
+            inst_ver = &pc_pkg->ver;
+        }
+        else
+            /* no such package (any version) installed */
+            reason = REASON_PKG_NOT_INSTALLED;
+
+        recomm = pkgclip->recomm[reason];
+
+        if (reclassify && pc_pkg->classified
+                && reason == pc_pkg->reason && recomm == pc_pkg->recomm
+                && old_ver == pc_pkg->nb_old_ver
+                && nb_old_ver == pc_pkg->nb_old_ver_total)
+            continue;
+
+        pc_pkg->reason = reason;
+        pc_pkg->nb_old_ver = old_ver;
+        pc_pkg->nb_old_ver_total = nb_old_ver;
+        if (!reclassify)
+            /* marked packages were reset */
+            pc_pkg->remove = FALSE;
+        pc_pkg->classified = TRUE;
+        if (!reclassify || recomm != pc_pkg->recomm)
+        {
+            pc_pkg->recomm = recomm;
+            set_remove (pc_pkg, recomm == RECOMM_REMOVE, pkgclip);
+        }
+        if (reclassify)
+            changed (pc_pkg, data);
+    }
+}
+
+/* returns the index after the last version of the package at index first */
+guint
+get_group_end (guint first, pkgclip_t *pkgclip)
+{
+    const char *name = ((pc_pkg_t *) g_ptr_array_index (pkgclip->packages, first))->name;
+    guint i;
+
+    for (i = first + 1; i < pkgclip->packages->len; ++i)
+        if (strcmp (name, ((pc_pkg_t *) g_ptr_array_index (pkgclip->packages, i))->name) != 0)
+            break;
+    return i;
+}
+
+void
+prepare_snapshot (pkgclip_t *pkgclip)
+{
+    /* info from local db, only built once per reload */
+    if (!pkgclip->snapshot)
+        pkgclip->snapshot = snapshot_new (pkgclip->handle);
+    snapshot_set_as_installed (pkgclip->snapshot, pkgclip->as_installed);
+}
+
+/* classifies all packages. See classify_group() about changed */
+void
+classify_packages (pkg_changed_fn changed, gpointer data, pkgclip_t *pkgclip)
+{
+    guint i, last;
+
+    prepare_snapshot (pkgclip);
+    for (i = 0; i < pkgclip->packages->len; i = last)
+    {
+        last = get_group_end (i, pkgclip);
+        classify_group (i, last, changed, data, pkgclip);
+    }
+}
+
+/* finds all versions of the given package; returns FALSE if there are none */
+gboolean
+find_group (const char *name, guint *first, guint *last, pkgclip_t *pkgclip)
+{
+    guint f = 0, l = pkgclip->packages->len;
+
+    /* packages are sorted by name, find the first version of this one */
+    while (f < l)
+    {
+        guint mid = f + (l - f) / 2;
+        pc_pkg_t *pc_pkg = g_ptr_array_index (pkgclip->packages, mid);
+
+        if (strcmp (pc_pkg->name, name) < 0)
+            f = mid + 1;
+        else
+            l = mid;
+    }
+    if (f >= pkgclip->packages->len || strcmp (name,
+                ((pc_pkg_t *) g_ptr_array_index (pkgclip->packages, f))->name) != 0)
+        return FALSE;
+
+    *first = f;
+    *last = get_group_end (f, pkgclip);
+    return TRUE;
+}
+
+/* state shared by the workers loading packages, during a reload */
+typedef struct _scan_t {
+    pkgclip_t   *pkgclip;
+    mdcache_t   *mdcache;
+    /* built before workers start, read-only afterwards */
+    sync_index_t *syncidx;
+    /* batches of packages loaded, for the GUI to show while scanning */
+    GAsyncQueue *queue;
+    GPtrArray   *batch;
+    /* ALPM handles not in use, see get_handle */
+    GAsyncQueue *handles;
+    /* protects mdcache, pkgclip->packages, batch and totals */
+    GMutex       mutex;
+} scan_t;
+
+/* how many packages are handed over to the GUI at once while scanning */
+#define SCAN_BATCH      256
+
+typedef struct _scan_job_t {
+    const char  *cachedir;
+    char         filename[];
+} scan_job_t;
+
+/* packages downloaded from a repo can be found in its sync db, where we can
+ * get the info from without opening the file. This loads the sync dbs, so it
+ * must be done (using pkgclip->handle) before workers are started */
+static sync_index_t *
+new_sync_index (pkgclip_t *pkgclip)
+{
+    sync_index_t *syncidx;
+    alpm_list_t *i, *j;
+
+    syncidx = g_new (sync_index_t, 1);
+    syncidx->pkgs = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    syncidx->strings = g_string_chunk_new (64 * 1024);
+    for (i = alpm_get_syncdbs (pkgclip->handle); i; i = alpm_list_next (i))
+        for (j = alpm_db_get_pkgcache (i->data); j; j = alpm_list_next (j))
+        {
+            const char *filename = alpm_pkg_get_filename (j->data);
+            const char *desc = alpm_pkg_get_desc (j->data);
+            const char *arch = alpm_pkg_get_arch (j->data);
+            sync_pkg_t *sync_pkg;
+
+            /* first db wins, as for pacman */
+            if (!filename || g_hash_table_contains (syncidx->pkgs, filename))
+                continue;
+
+            sync_pkg = g_new (sync_pkg_t, 1);
+            sync_pkg->name = g_string_chunk_insert_const (syncidx->strings,
+                    alpm_pkg_get_name (j->data));
+            sync_pkg->version = g_string_chunk_insert_const (syncidx->strings,
+                    alpm_pkg_get_version (j->data));
+            sync_pkg->desc = g_string_chunk_insert (syncidx->strings,
+                    (desc) ? desc : "");
+            sync_pkg->arch = g_string_chunk_insert_const (syncidx->strings,
+                    (arch) ? arch : "");
+            sync_pkg->size = alpm_pkg_get_size (j->data);
+            g_hash_table_insert (syncidx->pkgs,
+                    g_string_chunk_insert (syncidx->strings, filename),
+                    sync_pkg);
+        }
+    return syncidx;
+}
+
+static void
+free_sync_index (sync_index_t *syncidx)
+{
+    g_hash_table_unref (syncidx->pkgs);
+    g_string_chunk_free (syncidx->strings);
+    g_free (syncidx);
+}
+
+/* ALPM isn't thread-safe, so packages aren't loaded using pkgclip->handle but
+ * one handle per worker: they're created as needed, and given back once done
+ * for others to reuse. Returns NULL if one can't be created */
+static alpm_handle_t *
+get_handle (scan_t *scan)
+{
+    alpm_handle_t *handle;
+    enum _alpm_errno_t err;
+
+    handle = g_async_queue_try_pop (scan->handles);
+    if (!handle)
+        handle = alpm_initialize (scan->pkgclip->rootpath, scan->pkgclip->dbpath,
+                &err);
+    return handle;
+}
+
+static void
+release_handles (scan_t *scan)
+{
+    alpm_handle_t *handle;
+
+    while ((handle = g_async_queue_try_pop (scan->handles)))
+        alpm_release (handle);
+    g_async_queue_unref (scan->handles);
+}
+
+static gint64
+get_mtime (const struct stat *statbuf)
+{
+    return (gint64) statbuf->st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000)
+        + statbuf->st_mtim.tv_nsec;
+}
+
+/* whether statbuf is (still) about the file pc_pkg was loaded from; the size
+ * alone could be the same after a rebuild with the same version */
+gboolean
+pc_pkg_same_file (const pc_pkg_t *pc_pkg, const struct stat *statbuf)
+{
+    return statbuf->st_size == pc_pkg->filesize
+        && (guint64) statbuf->st_ino == pc_pkg->ino
+        && get_mtime (statbuf) == pc_pkg->mtime;
+}
+
+/* how much of the arena a package takes, strings shared with others aside */
+gsize
+pc_pkg_size (const pc_pkg_t *pc_pkg)
+{
+    return sizeof (*pc_pkg) + pc_ver_segs_size (pc_pkg->version)
+        + strlen (pc_pkg->file) + 1;
+}
+
+/* returns a new package, allocated from the current arena. desc can be NULL
+ * if unknown, see get_pc_pkg_desc */
+static pc_pkg_t *
+new_pc_pkg (pkgclip_t *pkgclip, const char *path, const struct stat *statbuf,
+            const char *name, const char *version, const char *desc)
+{
+    arena_t *arena = pkgclip->arena;
+    pc_pkg_t *pc_pkg;
+
+    pc_pkg = arena_alloc (arena, sizeof (*pc_pkg));
+    pc_pkg->file = arena_strdup (arena, path);
+    pc_pkg->filesize = statbuf->st_size;
+    pc_pkg->ino = (guint64) statbuf->st_ino;
+    pc_pkg->mtime = get_mtime (statbuf);
+    pc_pkg->name = arena_intern (arena, name);
+    pc_pkg->version = arena_intern (arena, version);
+    /* never shown in headless mode */
+    pc_pkg->desc = (desc && !pkgclip->headless) ? arena_intern (arena, desc) : NULL;
+
+    /* parse version once, for sorting & classifying */
+    pc_ver_parse_into (&pc_pkg->ver, pc_pkg->version,
+            arena_alloc (arena, pc_ver_segs_size (pc_pkg->version)));
+    return pc_pkg;
+}
+
+/* returns the package for file filename in cachedir, or NULL if it isn't
+ * one. Can be called from multiple threads at once */
+static pc_pkg_t *
+load_pkg (const char *cachedir, const char *filename, scan_t *scan)
+{
+    pkgclip_t *pkgclip = scan->pkgclip;
+    char path[PATH_MAX];
+    struct stat statbuf;
+    mdcache_entry_t *entry;
+    pc_pkg_t *pc_pkg = NULL;
+    sync_pkg_t *sync_pkg;
+    alpm_handle_t *handle;
+    alpm_pkg_t *pkg = NULL;
+    char *name, *version;
+
+    /* build the full filepath */
+    snprintf (path, PATH_MAX, "%s%s", cachedir, filename);
+
+    /* get file info, also used to validate cached metadata */
+    if (stat (path, &statbuf) != 0 || !S_ISREG (statbuf.st_mode))
+        return NULL;
+
+    sync_pkg = g_hash_table_lookup (scan->syncidx->pkgs, filename);
+
+    g_mutex_lock (&scan->mutex);
+    entry = mdcache_lookup (scan->mdcache, cachedir, filename, &statbuf);
+    /* from the sync db; we check the size to make sure it is the same file */
+    if (!entry && sync_pkg && sync_pkg->size == statbuf.st_size)
+        entry = mdcache_add (scan->mdcache, cachedir, filename, &statbuf,
+                sync_pkg->name, sync_pkg->version, sync_pkg->desc, sync_pkg->arch);
+    if (entry)
+        pc_pkg = new_pc_pkg (pkgclip, path, &statbuf,
+                entry->name, entry->version, entry->desc);
+    g_mutex_unlock (&scan->mutex);
+
+    if (pc_pkg)
+        return pc_pkg;
+
+    /* fast scan: get name & version from the filename, the description will
+     * only be loaded if needed (see get_pc_pkg_desc) */
+    if (pkgclip->fast_scan
+            && parse_pkg_filename (filename, &name, &version, NULL))
+    {
+        pc_pkg = new_pc_pkg (pkgclip, path, &statbuf,
+                name, version, NULL);
+        free (name);
+        free (version);
+        return pc_pkg;
+    }
+
+    /* attempt to load the package (just the metadata) to ensure
+     * it's a valid package. This is the expensive part, hence done
+     * without holding the lock. */
+    handle = get_handle (scan);
+    if (!handle)
+        return NULL;
+    if (alpm_pkg_load (handle, path, 0, 0, &pkg) != 0
+            || pkg == NULL)
+    {
+        if (pkg)
+            alpm_pkg_free (pkg);
+        g_async_queue_push (scan->handles, handle);
+        return NULL;
+    }
+    pc_pkg = new_pc_pkg (pkgclip, path, &statbuf,
+            alpm_pkg_get_name (pkg),
+            alpm_pkg_get_version (pkg),
+            (alpm_pkg_get_desc (pkg)) ? alpm_pkg_get_desc (pkg) : "");
+
+    /* we only keep what we need, in the cache */
+    g_mutex_lock (&scan->mutex);
+    mdcache_add (scan->mdcache, cachedir, filename, &statbuf,
+            pc_pkg->name, pc_pkg->version, alpm_pkg_get_desc (pkg),
+            alpm_pkg_get_arch (pkg));
+    g_mutex_unlock (&scan->mutex);
+    alpm_pkg_free (pkg);
+    g_async_queue_push (scan->handles, handle);
+
+    return pc_pkg;
+}
+
+/* after a fast scan the description might not be known, so we load it when
+ * needed: from the sync db if the file comes from a repo, else from the file
+ * itself */
+const char *
+get_pc_pkg_desc (pc_pkg_t *pc_pkg, pkgclip_t *pkgclip)
+{
+    const char *filename;
+    const char *desc = NULL;
+    alpm_pkg_t *pkg = NULL;
+    alpm_list_t *i;
+
+    if (pc_pkg->desc)
+        return pc_pkg->desc;
+    /* ALPM isn't thread-safe, and the handle is used by the scanning threads
+     * until loading is done; we'll get it next time */
+    if (pkgclip->is_loading)
+        return "";
+
+    filename = strrchr (pc_pkg->file, '/');
+    filename = (filename) ? filename + 1 : pc_pkg->file;
+    for (i = alpm_get_syncdbs (pkgclip->handle); i; i = alpm_list_next (i))
+    {
+        alpm_pkg_t *sync_pkg = alpm_db_get_pkg (i->data, pc_pkg->name);
+
+        /* same check as when scanning, to make sure it is the same file */
+        if (sync_pkg && alpm_pkg_get_filename (sync_pkg)
+                && strcmp (alpm_pkg_get_filename (sync_pkg), filename) == 0
+                && alpm_pkg_get_size (sync_pkg) == pc_pkg->filesize)
+        {
+            desc = alpm_pkg_get_desc (sync_pkg);
+            break;
+        }
+    }
+
+    if (!desc && alpm_pkg_load (pkgclip->handle, pc_pkg->file, 0, 0, &pkg) == 0
+            && pkg)
+        desc = alpm_pkg_get_desc (pkg);
+
+    pc_pkg->desc = arena_intern (pkgclip->arena, (desc) ? desc : "");
+    if (pkg)
+        alpm_pkg_free (pkg);
+    return pc_pkg->desc;
+}
+
+static void
+scan_load_pkg (scan_job_t *job, scan_t *scan)
+{
+    pkgclip_t *pkgclip = scan->pkgclip;
+    pc_pkg_t *pc_pkg;
+
+    /* once aborted, remaining jobs are simply dropped */
+    if (!pkgclip->abort
+            && (pc_pkg = load_pkg (job->cachedir, job->filename, scan)))
+    {
+        g_atomic_int_inc (&pkgclip->nb_loaded);
+
+        /* add it; the list will be sorted once all packages are loaded */
+        g_mutex_lock (&scan->mutex);
+        g_ptr_array_add (pkgclip->packages, pc_pkg);
+        if (scan->queue)
+        {
+            /* and hand it over to be shown meanwhile */
+            g_ptr_array_add (scan->batch, pc_pkg);
+            if (scan->batch->len >= SCAN_BATCH)
+            {
+                g_async_queue_push (scan->queue, scan->batch);
+                scan->batch = g_ptr_array_sized_new (SCAN_BATCH);
+            }
+        }
+        else
+        {
+            ++(pkgclip->total_packages);
+            pkgclip->total_size += pc_pkg->filesize;
+        }
+        g_mutex_unlock (&scan->mutex);
+    }
+    g_free (job);
+}
+
+/* gets what scan_load_files needs from the last full scan, or builds it if
+ * there was none (or the sync dbs changed since). Must be called from the
+ * thread using pkgclip->handle */
+void
+scan_prepare_load (pkgclip_t *pkgclip)
+{
+    if (!pkgclip->mdcache)
+        pkgclip->mdcache = mdcache_load ();
+    if (!pkgclip->syncidx)
+        pkgclip->syncidx = new_sync_index (pkgclip);
+}
+
+/* frees what was kept from the last full scan */
+void
+scan_free_cache (pkgclip_t *pkgclip)
+{
+    if (pkgclip->mdcache)
+    {
+        mdcache_free (pkgclip->mdcache);
+        pkgclip->mdcache = NULL;
+    }
+    if (pkgclip->syncidx)
+    {
+        free_sync_index (pkgclip->syncidx);
+        pkgclip->syncidx = NULL;
+    }
+}
+
+/* loads packages from the given files (full paths), outside of a full scan
+ * (e.g. as files show up in the cache). Packages are added to loaded, and not
+ * to pkgclip->packages; their info is added to the metadata cache. Stops early
+ * if aborted.
+ *
+ * Doesn't use pkgclip->handle, so it can be called from a worker thread once
+ * scan_prepare_load was called, as long as no (full) scan is started nor the
+ * arena replaced meanwhile. */
+void
+scan_load_files (GPtrArray *paths, GPtrArray *loaded, pkgclip_t *pkgclip)
+{
+    scan_t scan;
+    guint i;
+
+    scan.pkgclip = pkgclip;
+    scan.mdcache = pkgclip->mdcache;
+    scan.syncidx = pkgclip->syncidx;
+    scan.queue = NULL;
+    scan.batch = NULL;
+    scan.handles = g_async_queue_new ();
+    g_mutex_init (&scan.mutex);
+
+    for (i = 0; i < paths->len && !pkgclip->abort; ++i)
+    {
+        const char *path = g_ptr_array_index (paths, i);
+        const char *filename = strrchr (path, '/');
+        gchar *cachedir;
+        pc_pkg_t *pc_pkg;
+
+        if (!filename)
+            continue;
+        ++filename;
+        /* with the trailing slash, as cachedirs are */
+        cachedir = g_strndup (path, (gsize) (filename - path));
+        pc_pkg = load_pkg (cachedir, filename, &scan);
+        if (pc_pkg)
+            g_ptr_array_add (loaded, pc_pkg);
+        g_free (cachedir);
+    }
+
+    mdcache_save (scan.mdcache);
+    release_handles (&scan);
+    g_mutex_clear (&scan.mutex);
+}
+
+/* loads all packages from the cache directories into pkgclip->packages, sorted
+ * by name then version (most recent first). Blocks until done, or aborted.
+ *
+ * If queue is set, packages are also pushed onto it in batches (GPtrArray, to
+ * be unref-d) as they're loaded, and totals are left for the receiving end to
+ * update. pkgclip->packages must then not be used until this returns; progress
+ * can be followed using pkgclip->nb_found & nb_loaded (atomic).
+ *
+ * The metadata cache and sync index are kept in pkgclip afterwards, for
+ * scan_load_files (see scan_free_cache). */
+void
+scan_packages (scan_error_fn dir_error, GAsyncQueue *queue, pkgclip_t *pkgclip)
+{
+    alpm_list_t *cachedirs = alpm_option_get_cachedirs (pkgclip->handle);
+    alpm_list_t *scanned = NULL;
+    alpm_list_t *i;
+    scan_t scan;
+    GThreadPool *pool;
+    gint nb_threads;
+
+    /* whatever was kept from the last one */
+    scan_free_cache (pkgclip);
+
+    scan.pkgclip = pkgclip;
+    scan.mdcache = mdcache_load ();
+    scan.syncidx = new_sync_index (pkgclip);
+    scan.queue = queue;
+    scan.batch = (queue) ? g_ptr_array_sized_new (SCAN_BATCH) : NULL;
+    scan.handles = g_async_queue_new ();
+    g_mutex_init (&scan.mutex);
+    g_atomic_int_set (&pkgclip->nb_found, 0);
+    g_atomic_int_set (&pkgclip->nb_loaded, 0);
+
+    nb_threads = (pkgclip->scan_threads > 0)
+        ? pkgclip->scan_threads : (gint) g_get_num_processors ();
+    pool = g_thread_pool_new ((GFunc) scan_load_pkg, &scan, nb_threads,
+            FALSE, NULL);
+
+    for (i = cachedirs; i; i = alpm_list_next (i))
+    {
+        const char *cachedir = i->data;
+        DIR *dir = opendir (cachedir);
+        struct dirent *ent;
+
+        if (dir == NULL)
+        {
+            if (dir_error)
+                dir_error (cachedir, pkgclip);
+            continue;
+        }
+
+        rewinddir (dir);
+        /* step through the directory one file at a time, handing each one
+         * over to the pool */
+        while ((ent = readdir(dir)) != NULL)
+        {
+            scan_job_t *job;
+            size_t len;
+
+            if (strcmp (ent->d_name, ".") == 0 || strcmp (ent->d_name, "..") == 0)
+                continue;
+
+            /* we handle .sig files with packages, not separately */
+            len = strlen (ent->d_name);
+            if (len >= 4 && strcmp (ent->d_name + len - 4, ".sig") == 0)
+                continue;
+
+            job = g_malloc (sizeof (*job) + len + 1);
+            job->cachedir = cachedir;
+            memcpy (job->filename, ent->d_name, len + 1);
+            g_thread_pool_push (pool, job, NULL);
+            g_atomic_int_inc (&pkgclip->nb_found);
+
+            if (pkgclip->abort)
+                break;
+        }
+        closedir (dir);
+        if (pkgclip->abort)
+            break;
+        scanned = alpm_list_add (scanned, (void *) cachedir);
+    }
+
+    /* wait for all jobs to be processed (skipped, if aborted) */
+    g_thread_pool_free (pool, FALSE, TRUE);
+
+    if (scan.batch && scan.batch->len > 0)
+        g_async_queue_push (queue, scan.batch);
+    else if (scan.batch)
+        g_ptr_array_unref (scan.batch);
+
+    /* sort all packages at once */
+    g_ptr_array_sort (pkgclip->packages, (GCompareFunc) pc_pkg_ptr_cmp);
+
+    /* only now can we forget about files no longer there */
+    if (!pkgclip->abort)
+        for (i = scanned; i; i = alpm_list_next (i))
+            mdcache_prune (scan.mdcache, i->data);
+    alpm_list_free (scanned);
+
+    mdcache_save (scan.mdcache);
+    pkgclip->mdcache = scan.mdcache;
+    pkgclip->syncidx = scan.syncidx;
+    release_handles (&scan);
+    g_mutex_clear (&scan.mutex);
+}
@@ -0,0 +1,61 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * scan.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef _PKGCLIP_SCAN_H
+#define _PKGCLIP_SCAN_H
+
+typedef enum {
+    REFRESH_NONE,
+    /* databases changed, packages need reclassifying */
+    REFRESH_DB,
+    /* pacman.conf changed, e.g. cachedirs might be different */
+    REFRESH_CONF
+} alpm_refresh_t;
+
+struct stat;
+
+/* called (from a worker thread) when a cachedir could not be opened */
+typedef void (*scan_error_fn) (const char *cachedir, pkgclip_t *pkgclip);
+/* called when reclassifying, for each package whose classification changed */
+typedef void (*pkg_changed_fn) (pc_pkg_t *pc_pkg, gpointer data);
+
+int init_alpm (pkgclip_t *pkgclip);
+alpm_refresh_t refresh_alpm (pkgclip_t *pkgclip);
+int pc_pkg_cmp (const pc_pkg_t *pkg1, const pc_pkg_t *pkg2);
+gboolean pc_pkg_same_file (const pc_pkg_t *pc_pkg, const struct stat *statbuf);
+gsize pc_pkg_size (const pc_pkg_t *pc_pkg);
+guint get_group_end (guint first, pkgclip_t *pkgclip);
+void prepare_snapshot (pkgclip_t *pkgclip);
+void classify_group (guint first, guint last, pkg_changed_fn changed,
+                     gpointer data, pkgclip_t *pkgclip);
+void classify_packages (pkg_changed_fn changed, gpointer data,
+                        pkgclip_t *pkgclip);
+gboolean find_group (const char *name, guint *first, guint *last,
+                     pkgclip_t *pkgclip);
+void scan_packages (scan_error_fn dir_error, GAsyncQueue *queue,
+                    pkgclip_t *pkgclip);
+void scan_prepare_load (pkgclip_t *pkgclip);
+void scan_free_cache (pkgclip_t *pkgclip);
+void scan_load_files (GPtrArray *paths, GPtrArray *loaded, pkgclip_t *pkgclip);
+const char * get_pc_pkg_desc (pc_pkg_t *pc_pkg, pkgclip_t *pkgclip);
+
+#endif /* _PKGCLIP_SCAN_H */
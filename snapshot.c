@@ -0,0 +1,110 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * snapshot.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+/* C */
+#include <stdlib.h>
+
+/* pkgclip */
+#include "common.h"
+#include "snapshot.h"
+
+/* A snapshot holds what we need from the local database (installed packages &
+ * their parsed versions) in hash tables, so classifying packages doesn't need to go
+ * through ALPM (or linear searches). It only needs to be rebuilt when the
+ * local database changes, i.e. on reload; The list of packages to treat as
+ * installed is set separately, before each classification.
+ */
+
+static void
+free_pkg (snapshot_pkg_t *pkg)
+{
+    pc_ver_free (&pkg->ver);
+    g_free (pkg);
+}
+
+snapshot_t *
+snapshot_new (alpm_handle_t *handle)
+{
+    snapshot_t *snapshot;
+    alpm_list_t *i;
+
+    snapshot = calloc (1, sizeof (*snapshot));
+    snapshot->strings = g_string_chunk_new (4096);
+    snapshot->installed = g_hash_table_new_full (g_str_hash, g_str_equal,
+            NULL, (GDestroyNotify) free_pkg);
+    snapshot->as_installed = g_hash_table_new (g_str_hash, g_str_equal);
+
+    if (!handle)
+        return snapshot;
+
+    for (i = alpm_db_get_pkgcache (alpm_get_localdb (handle)); i;
+            i = alpm_list_next (i))
+    {
+        snapshot_pkg_t *pkg;
+
+        pkg = g_new (snapshot_pkg_t, 1);
+        pkg->version = g_string_chunk_insert (snapshot->strings,
+                alpm_pkg_get_version (i->data));
+        pc_ver_parse (&pkg->ver, pkg->version);
+        g_hash_table_insert (snapshot->installed,
+                g_string_chunk_insert (snapshot->strings,
+                    alpm_pkg_get_name (i->data)),
+                pkg);
+    }
+
+    return snapshot;
+}
+
+void
+snapshot_set_as_installed (snapshot_t *snapshot, alpm_list_t *as_installed)
+{
+    alpm_list_t *i;
+
+    /* names point to the strings in the list, which must thus remain valid
+     * as long as the snapshot is used (or until called again) */
+    g_hash_table_remove_all (snapshot->as_installed);
+    for (i = as_installed; i; i = alpm_list_next (i))
+        g_hash_table_add (snapshot->as_installed, i->data);
+}
+
+const snapshot_pkg_t *
+snapshot_get_installed (snapshot_t *snapshot, const char *name)
+{
+    return g_hash_table_lookup (snapshot->installed, name);
+}
+
+gboolean
+snapshot_is_as_installed (snapshot_t *snapshot, const char *name)
+{
+    return g_hash_table_contains (snapshot->as_installed, name);
+}
+
+void
+snapshot_free (snapshot_t *snapshot)
+{
+    g_hash_table_unref (snapshot->installed);
+    g_hash_table_unref (snapshot->as_installed);
+    g_string_chunk_free (snapshot->strings);
+    free (snapshot);
+}
@@ -0,0 +1,47 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * snapshot.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef _PKGCLIP_SNAPSHOT_H
+#define _PKGCLIP_SNAPSHOT_H
+
+/* installed package */
+typedef struct _snapshot_pkg_t {
+    const char  *version;
+    pc_ver_t     ver;
+} snapshot_pkg_t;
+
+typedef struct _snapshot_t {
+    GStringChunk *strings;
+    /* name -> snapshot_pkg_t */
+    GHashTable   *installed;
+    /* names of packages to treat as installed */
+    GHashTable   *as_installed;
+} snapshot_t;
+
+snapshot_t * snapshot_new (alpm_handle_t *handle);
+void snapshot_set_as_installed (snapshot_t *snapshot, alpm_list_t *as_installed);
+const snapshot_pkg_t * snapshot_get_installed (snapshot_t *snapshot,
+                                               const char *name);
+gboolean snapshot_is_as_installed (snapshot_t *snapshot, const char *name);
+void snapshot_free (snapshot_t *snapshot);
+
+#endif /* _PKGCLIP_SNAPSHOT_H */
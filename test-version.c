@@ -0,0 +1,229 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * test-version.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+
+#include "config.h"
+
+/* C */
+#include <stdio.h>
+#include <string.h>
+
+/* alpm */
+#include <alpm.h>
+
+/* pkgclip */
+#include "common.h"
+#include "version.h"
+
+/* pc_ver_cmp & pc_ver_cmp_pkgver must give the same results as libalpm's
+ * alpm_pkg_vercmp, which they replace (see version.c). Both are compared on
+ * hand-picked cases, then on random versions made of characters that matter to
+ * the comparison.
+ */
+
+#define SEED        20131013
+#define NB_RANDOM   200000
+#define MAX_LEN     12
+
+static const char *cases[][2] = {
+    /* plain */
+    { "1.0", "1.0" },
+    { "1.0", "1.1" },
+    { "1.1", "1.0.1" },
+    { "1.0", "1.0.0" },
+    { "", "" },
+    { "", "1" },
+    /* epochs */
+    { "1:1.0", "1.0" },
+    { "1:1.0", "2:0.1" },
+    { "0:1.0", "1.0" },
+    { "10:1.0", "9:1.0" },
+    { "1:1.0-1", "1:1.0-2" },
+    /* empty epoch */
+    { ":1.0", "1.0" },
+    { ":1.0", "0:1.0" },
+    { ":1.0-1", "1.0-1" },
+    { ":", "" },
+    /* separators */
+    { "1.0", "1_0" },
+    { "1..0", "1.0" },
+    { "1.0.", "1.0" },
+    { "1+0", "1.0" },
+    { "1.0~rc1", "1.0" },
+    { "1.", "1" },
+    { ".1", "1" },
+    { "1.0", "1.0." },
+    /* leading zeros */
+    { "1.01", "1.1" },
+    { "1.001", "1.01" },
+    { "1.0010", "1.010" },
+    { "01", "1" },
+    { "1.00", "1.0" },
+    { "000", "0" },
+    /* alpha, numbers & empty */
+    { "1.0a", "1.0" },
+    { "1.0alpha", "1.0" },
+    { "1.0a", "1.0.1" },
+    { "1.0a", "1.0b" },
+    { "1.0rc1", "1.0" },
+    { "1.a", "1.1" },
+    { "a", "1" },
+    { "1.0a1", "1.0.a1" },
+    { "1.0A", "1.0a" },
+    /* pkgrel, or lack thereof */
+    { "1.0-1", "1.0-2" },
+    { "1.0-1", "1.0" },
+    { "1.0", "1.0-1" },
+    { "1.0-1.1", "1.0-1" },
+    { "1.0-2", "1.0-1.1" },
+    { "1.0-", "1.0" },
+    { "1.0-1", "1.0-1a" },
+    { "1.0-1-1", "1.0-1" },
+    { "1-0", "1.0" },
+};
+
+static int
+sign (int r)
+{
+    return (r > 0) - (r < 0);
+}
+
+/* pkgver only: same as what pc_ver_cmp_pkgver compares. Returns FALSE if
+ * version has more than one dash, see pc_ver_cmp_pkgver */
+static gboolean
+strip_pkgrel (char *dst, const char *version)
+{
+    char *s;
+
+    strcpy (dst, version);
+    if ((s = strrchr (dst, '-')))
+        *s = '\0';
+    return strchr (dst, '-') == NULL;
+}
+
+static int
+check (const char *v1, const char *v2)
+{
+    char s1[MAX_LEN * 4], s2[MAX_LEN * 4];
+    pc_ver_t ver1, ver2;
+    int expected, got, failed = 0;
+
+    pc_ver_parse (&ver1, v1);
+    pc_ver_parse (&ver2, v2);
+
+    expected = sign (alpm_pkg_vercmp (v1, v2));
+    got = sign (pc_ver_cmp (&ver1, &ver2));
+    if (got != expected)
+    {
+        fprintf (stderr, "pc_ver_cmp (\"%s\", \"%s\") = %d, expected %d\n",
+                v1, v2, got, expected);
+        ++failed;
+    }
+
+    if (strip_pkgrel (s1, v1) && strip_pkgrel (s2, v2))
+    {
+        expected = sign (alpm_pkg_vercmp (s1, s2));
+        got = sign (pc_ver_cmp_pkgver (&ver1, &ver2));
+        if (got != expected)
+        {
+            fprintf (stderr, "pc_ver_cmp_pkgver (\"%s\", \"%s\") = %d, expected %d\n",
+                    v1, v2, got, expected);
+            ++failed;
+        }
+    }
+
+    pc_ver_free (&ver1);
+    pc_ver_free (&ver2);
+    return failed;
+}
+
+/* digits (incl. zeros), letters and all kinds of separators */
+static const char chars[] = "00011299aZb.._+~:-";
+
+static char
+random_char (GRand *rand)
+{
+    return chars[g_rand_int_range (rand, 0, (gint) sizeof (chars) - 1)];
+}
+
+static void
+random_version (GRand *rand, char *buf)
+{
+    gint i, len;
+
+    len = g_rand_int_range (rand, 0, MAX_LEN + 1);
+    for (i = 0; i < len; ++i)
+        buf[i] = random_char (rand);
+    buf[len] = '\0';
+}
+
+int
+main (void)
+{
+    GRand *rand;
+    char v1[MAX_LEN + 1], v2[MAX_LEN + 1];
+    int failed = 0;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (cases); ++i)
+    {
+        failed += check (cases[i][0], cases[i][1]);
+        failed += check (cases[i][1], cases[i][0]);
+    }
+
+    rand = g_rand_new_with_seed (SEED);
+    for (i = 0; i < NB_RANDOM; ++i)
+    {
+        gint len;
+
+        random_version (rand, v1);
+        len = (gint) strlen (v1);
+        /* also compare similar versions, not just unrelated ones */
+        switch (g_rand_int_range (rand, 0, 3))
+        {
+            case 0:
+                random_version (rand, v2);
+                break;
+            case 1:
+                /* a prefix */
+                strcpy (v2, v1);
+                v2[g_rand_int_range (rand, 0, len + 1)] = '\0';
+                break;
+            case 2:
+                /* one char changed */
+                strcpy (v2, v1);
+                if (len > 0)
+                    v2[g_rand_int_range (rand, 0, len)] = random_char (rand);
+                break;
+        }
+        failed += check (v1, v2);
+        failed += check (v2, v1);
+    }
+    g_rand_free (rand);
+
+    if (failed > 0)
+    {
+        fprintf (stderr, "%d comparison(s) differ from alpm_pkg_vercmp\n", failed);
+        return 1;
+    }
+    return 0;
+}
@@ -24,15 +24,17 @@
 #include "config.h"
 
 /* C */
+#include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
 #include <dirent.h> /* PATH_MAX */
 #include <errno.h>
 #include <stdio.h>
 #include <glob.h>
+#include <unistd.h>
 
 /* pkgclip */
-#include "pkgclip.h"
+#include "common.h"
 #include "util.h"
 
 
@@ -40,7 +42,6 @@ static void setrepeatingoption (char *ptr, alpm_list_t **list);
 static void parse_config_file (const char *file, gboolean is_pacman, int depth,
     pkgclip_t *pkgclip);
 static void setstringoption (char *value, char **cfg);
-static void setrecommoption (char *value, recomm_t *cfg);
 
 /*******************************************************************************
  * The following functions come from pacman's source code. (They might have
@@ -123,6 +124,74 @@ strtrim (char *str)
     return str;
 }
 
+static gboolean
+is_valid_field (const char *s, size_t len, const char *extra)
+{
+    size_t i;
+
+    if (len == 0)
+        return FALSE;
+    for (i = 0; i < len; ++i)
+        if (!isalnum ((unsigned char) s[i]) && !strchr (extra, s[i]))
+            return FALSE;
+    return TRUE;
+}
+
+/**
+ * Extract package info from a package filename, i.e. of the form
+ * name-pkgver-pkgrel-arch.pkg.tar[.ext]
+ * @param filename the package filename (no path)
+ * @param name will be set to a newly allocated string of the package name
+ * @param version will be set to a newly allocated string of the version (i.e.
+ * [epoch:]pkgver-pkgrel)
+ * @param arch (optional) will be set to a newly allocated string of the arch
+ *
+ * @return TRUE if filename was successfully parsed, else FALSE and nothing was
+ * allocated
+ */
+gboolean
+parse_pkg_filename (const char *filename, char **name, char **version, char **arch)
+{
+    const char *ext, *s, *e;
+    const char *dash[3];
+    int i;
+
+    /* find the extension, allowing only one (compression) suffix after it */
+    ext = g_strrstr (filename, ".pkg.tar");
+    if (!ext || ext == filename)
+        return FALSE;
+    s = ext + 8; /* 8 == strlen (".pkg.tar") */
+    if (*s != '\0' && (*s != '.' || !is_valid_field (s + 1, strlen (s + 1), "")))
+        return FALSE;
+
+    /* the last 3 dashes separate name, pkgver, pkgrel & arch */
+    e = ext;
+    for (i = 0; i < 3; ++i)
+    {
+        for (s = e - 1; s > filename && *s != '-'; --s)
+            ;
+        if (s <= filename)
+            return FALSE;
+        dash[i] = s;
+        e = s;
+    }
+
+    /* arch, pkgrel, pkgver then name */
+    if (!is_valid_field (dash[0] + 1, (size_t) (ext - dash[0] - 1), "_")
+            || dash[0] - dash[1] - 1 <= 0
+            || strspn (dash[1] + 1, "0123456789.") != (size_t) (dash[0] - dash[1] - 1)
+            || !is_valid_field (dash[2] + 1, (size_t) (dash[1] - dash[2] - 1), ".:_+~")
+            || !is_valid_field (filename, (size_t) (dash[2] - filename), "@._+-")
+            || *filename == '-' || *filename == '.')
+        return FALSE;
+
+    *name = strndup (filename, (size_t) (dash[2] - filename));
+    *version = strndup (dash[2] + 1, (size_t) (dash[0] - dash[2] - 1));
+    if (arch)
+        *arch = strndup (dash[0] + 1, (size_t) (ext - dash[0] - 1));
+    return TRUE;
+}
+
 /** Add repeating options such as NoExtract, NoUpgrade, etc to libalpm
  * settings. Refactored out of the parseconfig code since all of them did
  * the exact same thing and duplicated code.
@@ -199,6 +268,10 @@ parse_config_file (const char *file, gboolean is_pacman, int depth, pkgclip_t *p
             ++name;
             /* we only allow "options" as section name, ignore everything else */
             ignore_section = (strcmp (name, "options") != 0);
+            /* but remember repos, to use their sync databases */
+            if (ignore_section
+                    && !alpm_list_find_str (pkgclip->syncdbs, name))
+                pkgclip->syncdbs = alpm_list_add (pkgclip->syncdbs, strdup (name));
             continue;
         }
 
@@ -259,6 +332,10 @@ parse_config_file (const char *file, gboolean is_pacman, int depth, pkgclip_t *p
                 setstringoption (value, &(pkgclip->pacmanconf));
             else if (strcmp (key, "NoAutoload") == 0)
                 pkgclip->autoload = FALSE;
+            else if (strcmp (key, "FastScan") == 0)
+                pkgclip->fast_scan = TRUE;
+            else if (strcmp (key, "NoWatchCache") == 0)
+                pkgclip->watch_cache = FALSE;
             else if (strcmp (key, "PkgrelNoSpecial") == 0)
                 pkgclip->old_pkgrel = FALSE;
             else if (strcmp (key, "NbOldVersion") == 0)
@@ -281,25 +358,22 @@ parse_config_file (const char *file, gboolean is_pacman, int depth, pkgclip_t *p
                     free (s);
                 }
             }
+            else if (strcmp (key, "ScanThreads") == 0)
+            {
+                char *s = NULL;
+                setstringoption (value, &s);
+                if (NULL != s)
+                {
+                    pkgclip->scan_threads = atoi (s);
+                    free (s);
+                }
+            }
             else if (strcmp (key, "AsInstalled") == 0)
                 setrepeatingoption (value, &(pkgclip->as_installed));
             else if (strncmp (key, "RecommFor", 9) == 0) /* 9 == strlen("RecommFor") */
             {
-                char *s;
-                s = key + 9;
-
-                if (strcmp (s, "NewerThanInstalled") == 0)
-                    setrecommoption (value, &(pkgclip->recomm[REASON_NEWER_THAN_INSTALLED]));
-                else if (strcmp (s, "Installed") == 0)
-                    setrecommoption (value, &(pkgclip->recomm[REASON_INSTALLED]));
-                else if (strcmp (s, "OlderVersion") == 0)
-                    setrecommoption (value, &(pkgclip->recomm[REASON_OLDER_VERSION]));
-                else if (strcmp (s, "AlreadyOlderVersion") == 0)
-                    setrecommoption (value, &(pkgclip->recomm[REASON_ALREADY_OLDER_VERSION]));
-                else if (strcmp (s, "OlderPkgrel") == 0)
-                    setrecommoption (value, &(pkgclip->recomm[REASON_OLDER_PKGREL]));
-                else if (strcmp (s, "PkgNotInstalled") == 0)
-                    setrecommoption (value, &(pkgclip->recomm[REASON_PKG_NOT_INSTALLED]));
+                if (NULL != value)
+                    set_recomm (key + 9, value, pkgclip);
             }
             else if (strcmp (key, "HidePkgInfo") == 0)
                 pkgclip->show_pkg_info = FALSE;
@@ -315,111 +389,19 @@ parse_config_file (const char *file, gboolean is_pacman, int depth, pkgclip_t *p
 
 /******************************************************************************/
 
-gboolean
-confirm (const gchar *message,
-         const gchar *submessage,
-         const gchar *btn_yes_label,
-         const gchar *btn_yes_image,
-         const gchar *btn_no_label,
-         const gchar *btn_no_image,
-         pkgclip_t *pkgclip
-         )
-{
-    GtkWidget *dialog;
-    GtkWidget *button;
-    GtkWidget *image;
-    gint       rc;
-
-    if (NULL == submessage)
-    {
-        dialog = gtk_message_dialog_new_with_markup (
-                GTK_WINDOW(pkgclip->window),
-                GTK_DIALOG_DESTROY_WITH_PARENT,
-                GTK_MESSAGE_QUESTION,
-                GTK_BUTTONS_NONE,
-                NULL);
-        gtk_message_dialog_set_markup (GTK_MESSAGE_DIALOG(dialog), message);
-    }
-    else
-    {
-        dialog = gtk_message_dialog_new (
-                GTK_WINDOW(pkgclip->window),
-                GTK_DIALOG_DESTROY_WITH_PARENT,
-                GTK_MESSAGE_QUESTION,
-                GTK_BUTTONS_NONE,
-                "%s",
-                message);
-        gtk_message_dialog_format_secondary_markup (
-                GTK_MESSAGE_DIALOG(dialog),
-                "%s",
-                submessage);
-    }
-
-    gtk_window_set_decorated (GTK_WINDOW(dialog), FALSE);
-    gtk_window_set_skip_taskbar_hint (GTK_WINDOW(dialog), TRUE);
-    gtk_window_set_skip_pager_hint (GTK_WINDOW(dialog), TRUE);
-
-    button = gtk_dialog_add_button(
-            GTK_DIALOG(dialog),
-            (NULL == btn_no_label) ? "No" : btn_no_label,
-            GTK_RESPONSE_NO);
-    image = gtk_image_new_from_icon_name (
-            (NULL == btn_no_image) ? "gtk-no" : btn_no_image,
-            GTK_ICON_SIZE_MENU);
-    gtk_button_set_image( GTK_BUTTON(button), image);
-
-    button = gtk_dialog_add_button(
-            GTK_DIALOG(dialog),
-            (NULL == btn_yes_label) ? "Yes" : btn_yes_label,
-            GTK_RESPONSE_YES);
-    image = gtk_image_new_from_icon_name (
-            (NULL == btn_yes_image) ? "gtk-yes" : btn_yes_image,
-            GTK_ICON_SIZE_MENU);
-    gtk_button_set_image( GTK_BUTTON(button), image);
-
-    gtk_dialog_set_default_response(GTK_DIALOG(dialog), GTK_RESPONSE_NO);
-    rc = gtk_dialog_run (GTK_DIALOG(dialog));
-    gtk_widget_destroy (dialog);
-    return rc == GTK_RESPONSE_YES;
-}
-
 void
 show_error (const gchar *message, const gchar *submessage, pkgclip_t *pkgclip)
 {
-    GtkWidget *dialog;
-
-    if (NULL == submessage)
+    if (pkgclip->show_error)
     {
-        dialog = gtk_message_dialog_new_with_markup (
-                GTK_WINDOW(pkgclip->window),
-                GTK_DIALOG_DESTROY_WITH_PARENT,
-                GTK_MESSAGE_ERROR,
-                GTK_BUTTONS_OK,
-                NULL);
-        gtk_message_dialog_set_markup (GTK_MESSAGE_DIALOG(dialog), message);
-    }
-    else
-    {
-        dialog = gtk_message_dialog_new (
-                GTK_WINDOW(pkgclip->window),
-                GTK_DIALOG_DESTROY_WITH_PARENT,
-                GTK_MESSAGE_ERROR,
-                GTK_BUTTONS_OK,
-                "%s",
-                message);
-        gtk_message_dialog_format_secondary_markup (
-                GTK_MESSAGE_DIALOG(dialog),
-                "%s",
-                submessage);
+        pkgclip->show_error (message, submessage, pkgclip);
+        return;
     }
 
-    gtk_window_set_decorated (GTK_WINDOW(dialog), FALSE);
-    gtk_window_set_skip_taskbar_hint (GTK_WINDOW(dialog), TRUE);
-    gtk_window_set_skip_pager_hint (GTK_WINDOW(dialog), TRUE);
-
-    g_signal_connect_swapped (dialog, "response",
-            G_CALLBACK (gtk_widget_destroy), dialog);
-    gtk_widget_show_all (dialog);
+    if (NULL == submessage)
+        fprintf (stderr, "%s\n", message);
+    else
+        fprintf (stderr, "%s: %s\n", message, submessage);
 }
 
 static void
@@ -446,13 +428,37 @@ setstringoption (char *value, char **cfg)
     *cfg = strdup (value);
 }
 
-static void
-setrecommoption (char *value, recomm_t *cfg)
+/* keys used for the recommendations, i.e. RecommFor<key> in the config file */
+const char *reason_keys[NB_REASONS] = {
+    "AsInstalled",
+    "NewerThanInstalled",
+    "Installed",
+    "OlderVersion",
+    "AlreadyOlderVersion",
+    "OlderPkgrel",
+    "PkgNotInstalled"
+};
+
+gboolean
+set_recomm (const char *reason, const char *value, pkgclip_t *pkgclip)
 {
-    if (strcmp (value, "Keep") == 0)
-        *cfg = RECOMM_KEEP;
-    else if (strcmp (value, "Remove") == 0)
-        *cfg = RECOMM_REMOVE;
+    recomm_t recomm;
+    int i;
+
+    if (g_ascii_strcasecmp (value, "Keep") == 0)
+        recomm = RECOMM_KEEP;
+    else if (g_ascii_strcasecmp (value, "Remove") == 0)
+        recomm = RECOMM_REMOVE;
+    else
+        return FALSE;
+
+    for (i = 0; i < NB_REASONS; ++i)
+        if (g_ascii_strcasecmp (reason, reason_keys[i]) == 0)
+        {
+            pkgclip->recomm[i] = recomm;
+            return TRUE;
+        }
+    return FALSE;
 }
 
 void
@@ -586,12 +592,17 @@ load_pkg_info (pkgclip_t *pkgclip)
 }
 
 pkgclip_t *
-new_pkgclip (void)
+new_pkgclip (error_fn show_error_fn)
 {
     pkgclip_t *pkgclip = calloc (1, sizeof (*pkgclip));
 
+    /* without it errors go to stderr instead of dialogs */
+    pkgclip->show_error = show_error_fn;
+    pkgclip->headless = (show_error_fn == NULL);
+
     /* set some defaults */
     pkgclip->autoload = TRUE;
+    pkgclip->watch_cache = TRUE;
     pkgclip->old_pkgrel = TRUE;
     pkgclip->recomm[REASON_NEWER_THAN_INSTALLED]    = RECOMM_KEEP;
     pkgclip->recomm[REASON_INSTALLED]               = RECOMM_KEEP;
@@ -649,6 +660,14 @@ save_config (pkgclip_t *pkgclip)
         if (EOF == fputs ("NoAutoload\n", fp))
             goto err_save;
 
+    if (pkgclip->fast_scan)
+        if (EOF == fputs ("FastScan\n", fp))
+            goto err_save;
+
+    if (!pkgclip->watch_cache)
+        if (EOF == fputs ("NoWatchCache\n", fp))
+            goto err_save;
+
     if (!pkgclip->old_pkgrel)
         if (EOF == fputs ("PkgrelNoSpecial\n", fp))
             goto err_save;
@@ -667,6 +686,13 @@ save_config (pkgclip_t *pkgclip)
             goto err_save;
     }
 
+    if (pkgclip->scan_threads > 0)
+    {
+        snprintf (buf, 1024, "ScanThreads = %d\n", pkgclip->scan_threads);
+        if (EOF == fputs (buf, fp))
+            goto err_save;
+    }
+
     if (!pkgclip->show_pkg_info)
         if (EOF == fputs ("HidePkgInfo\n", fp))
             goto err_save;
@@ -707,6 +733,9 @@ save_config (pkgclip_t *pkgclip)
             goto err_save;
     }
 
+    if (pkgclip->recomm[REASON_AS_INSTALLED] != RECOMM_KEEP)
+        if (EOF == fputs ("RecommForAsInstalled = Remove\n", fp))
+            goto err_save;
     if (pkgclip->recomm[REASON_NEWER_THAN_INSTALLED] != RECOMM_KEEP)
         if (EOF == fputs ("RecommForNewerThanInstalled = Remove\n", fp))
             goto err_save;
@@ -759,6 +788,7 @@ free_pkgclip (pkgclip_t *pkgclip)
     {
         FREELIST (pkgclip->cachedirs);
     }
+    FREELIST (pkgclip->syncdbs);
     free (pkgclip->pkg_info);
     alpm_list_free (pkgclip->pkg_info_extras);
     if (pkgclip->str_info)
@@ -25,17 +25,22 @@
 
 #define PKG_INFO_TPL    "<b>$NAME</b> $VERSION\\t<i>$FILE\\t($SIZE)</i>\\n$DESC\\n$REASON [$RECOMM]"
 
+/* shows an error to the user, e.g. in a dialog (see dialog.h) */
+typedef void (*error_fn) (const gchar *message, const gchar *submessage,
+                          pkgclip_t *pkgclip);
+
+extern const char *reason_keys[NB_REASONS];
+
 char * strtrim (char *str);
 double humanize_size (off_t bytes, const char target_unit, const char **label);
+gboolean parse_pkg_filename (const char *filename, char **name, char **version,
+                             char **arch);
 void show_error (const gchar *message, const gchar *submessage, pkgclip_t *pkgclip);
-gboolean confirm (const gchar *message, const gchar *submessage,
-                  const gchar *btn_yes_label, const gchar *btn_yes_image,
-                  const gchar *btn_no_label, const gchar *btn_no_image,
-                  pkgclip_t *pkgclip);
 void parse_pacmanconf (pkgclip_t *pkgclip);
 char * get_tpl_pkg_info (pkgclip_t *pkgclip);
 void load_pkg_info (pkgclip_t *pkgclip);
-pkgclip_t * new_pkgclip (void);
+gboolean set_recomm (const char *reason, const char *value, pkgclip_t *pkgclip);
+pkgclip_t * new_pkgclip (error_fn show_error_fn);
 gboolean save_config (pkgclip_t *pkgclip);
 void free_pkgclip (pkgclip_t *pkgclip);
 
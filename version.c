@@ -0,0 +1,275 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * version.c
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+/* C */
+#include <string.h>
+#include <ctype.h>
+
+/* pkgclip */
+#include "common.h"
+#include "version.h"
+
+/* Versions are compared exactly as libalpm's alpm_pkg_vercmp() does, only we
+ * split them into segments once, instead of doing it on every comparison.
+ *
+ * libalpm splits the version into epoch, version & release (parseEVR) then
+ * compares each with rpmvercmp(), walking both strings at once: separators
+ * (non-alnum chars) are skipped, then segments (all digits, or all letters)
+ * are compared one after the other. cmp_part() follows the same steps, using
+ * what parse_part() stored about the segments (and separators) of each.
+ */
+
+typedef enum {
+    CLS_END,
+    CLS_ALPHA,
+    CLS_OTHER
+} cls_t;
+
+static guint
+count_segs (const char *s)
+{
+    guint nb = 0;
+    int last = 0;   /* 0: separator, 1: digit, 2: alpha */
+    int cur;
+
+    for ( ; *s; ++s)
+    {
+        if (isdigit ((unsigned char) *s))
+            cur = 1;
+        else if (isalpha ((unsigned char) *s))
+            cur = 2;
+        else
+            cur = 0;
+        if (cur && cur != last)
+            ++nb;
+        last = cur;
+    }
+    return nb;
+}
+
+static pc_ver_seg_t *
+parse_part (pc_ver_part_t *part, pc_ver_seg_t *seg, const char *s, const char *e)
+{
+    guint sep = 0;
+
+    part->segs = seg;
+    part->nb_segs = 0;
+    while (s < e)
+    {
+        const char *start = s;
+
+        if (isdigit ((unsigned char) *s))
+        {
+            while (s < e && isdigit ((unsigned char) *s))
+                ++s;
+            /* leading zeros are ignored */
+            while (start < s && *start == '0')
+                ++start;
+            seg->is_num = TRUE;
+        }
+        else if (isalpha ((unsigned char) *s))
+        {
+            while (s < e && isalpha ((unsigned char) *s))
+                ++s;
+            seg->is_num = FALSE;
+        }
+        else
+        {
+            ++sep;
+            ++s;
+            continue;
+        }
+        seg->str = start;
+        seg->len = (guint) (s - start);
+        seg->sep = sep;
+        sep = 0;
+        ++seg;
+        ++part->nb_segs;
+    }
+    part->trail = sep;
+    return seg;
+}
+
+/* memory needed for the segments of version */
+gsize
+pc_ver_segs_size (const char *version)
+{
+    /* one more, in case we need a default epoch */
+    return (count_segs (version) + 1) * sizeof (pc_ver_seg_t);
+}
+
+void
+pc_ver_parse (pc_ver_t *ver, const char *version)
+{
+    pc_ver_parse_into (ver, version, g_malloc (pc_ver_segs_size (version)));
+}
+
+/* same as pc_ver_parse, using segs (of pc_ver_segs_size bytes) owned by the
+ * caller; pc_ver_free must then not be used */
+void
+pc_ver_parse_into (pc_ver_t *ver, const char *version, pc_ver_seg_t *segs)
+{
+    const char *s, *se, *end;
+    pc_ver_seg_t *seg;
+
+    ver->segs = segs;
+    seg = ver->segs;
+    end = version + strlen (version);
+
+    /* same as parseEVR: epoch are the leading digits, if followed by ':' */
+    for (s = version; isdigit ((unsigned char) *s); ++s)
+        ;
+    se = strrchr (s, '-');
+
+    if (*s == ':' && s > version)
+    {
+        seg = parse_part (&ver->epoch, seg, version, s);
+        ++s;
+    }
+    else
+    {
+        /* no (or empty) epoch means 0 */
+        seg->str = "";
+        seg->len = 0;
+        seg->sep = 0;
+        seg->is_num = TRUE;
+        ver->epoch.segs = seg;
+        ver->epoch.nb_segs = 1;
+        ver->epoch.trail = 0;
+        ++seg;
+        if (*s == ':')
+            ++s;
+        else
+            s = version;
+    }
+
+    ver->has_pkgrel = (se != NULL);
+    seg = parse_part (&ver->pkgver, seg, s, (se) ? se : end);
+    if (se)
+        parse_part (&ver->pkgrel, seg, se + 1, end);
+    else
+        memset (&ver->pkgrel, 0, sizeof (ver->pkgrel));
+}
+
+/* what rpmvercmp's pointer would be on once it leaves its loop, having
+ * compared k segments; skipped is whether separators were skipped already */
+static cls_t
+get_cls (const pc_ver_part_t *part, guint k, gboolean skipped)
+{
+    if (k < part->nb_segs)
+    {
+        if (!skipped && part->segs[k].sep > 0)
+            return CLS_OTHER;
+        return (part->segs[k].is_num) ? CLS_OTHER : CLS_ALPHA;
+    }
+    return (!skipped && part->trail > 0) ? CLS_OTHER : CLS_END;
+}
+
+static int
+showdown (const pc_ver_part_t *part1, const pc_ver_part_t *part2, guint k,
+          gboolean skipped)
+{
+    cls_t c1 = get_cls (part1, k, skipped);
+    cls_t c2 = get_cls (part2, k, skipped);
+
+    if (c1 == CLS_END && c2 == CLS_END)
+        return 0;
+    /* we never want a remaining alpha string to beat an empty string */
+    if ((c1 == CLS_END && c2 != CLS_ALPHA) || c1 == CLS_ALPHA)
+        return -1;
+    return 1;
+}
+
+static int
+cmp_part (const pc_ver_part_t *part1, const pc_ver_part_t *part2)
+{
+    guint k;
+
+    for (k = 0; ; ++k)
+    {
+        const pc_ver_seg_t *seg1, *seg2;
+        int ret;
+
+        /* nothing left at all in one of them */
+        if ((k >= part1->nb_segs && part1->trail == 0)
+                || (k >= part2->nb_segs && part2->trail == 0))
+            return showdown (part1, part2, k, FALSE);
+        /* only separators left in one of them */
+        if (k >= part1->nb_segs || k >= part2->nb_segs)
+            return showdown (part1, part2, k, TRUE);
+
+        seg1 = &part1->segs[k];
+        seg2 = &part2->segs[k];
+
+        /* different separator lengths */
+        if (seg1->sep != seg2->sep)
+            return (seg1->sep < seg2->sep) ? -1 : 1;
+        /* numeric segments are always newer than alpha ones */
+        if (seg1->is_num != seg2->is_num)
+            return (seg1->is_num) ? 1 : -1;
+        /* whichever number has more digits wins */
+        if (seg1->is_num && seg1->len != seg2->len)
+            return (seg1->len > seg2->len) ? 1 : -1;
+
+        ret = memcmp (seg1->str, seg2->str, MIN (seg1->len, seg2->len));
+        if (ret != 0)
+            return (ret < 0) ? -1 : 1;
+        if (seg1->len != seg2->len)
+            return (seg1->len < seg2->len) ? -1 : 1;
+    }
+}
+
+/* same result as alpm_pkg_vercmp() */
+int
+pc_ver_cmp (const pc_ver_t *ver1, const pc_ver_t *ver2)
+{
+    int ret;
+
+    ret = pc_ver_cmp_pkgver (ver1, ver2);
+    if (ret == 0 && ver1->has_pkgrel && ver2->has_pkgrel)
+        ret = cmp_part (&ver1->pkgrel, &ver2->pkgrel);
+    return ret;
+}
+
+/* compare versions ignoring the pkgrel, i.e. same as alpm_pkg_vercmp() on
+ * versions with their pkgrel removed. (Unless the pkgver has a dash, which
+ * makepkg doesn't allow: alpm_pkg_vercmp() would then take what follows as
+ * pkgrel, whereas we compare the whole pkgver.) */
+int
+pc_ver_cmp_pkgver (const pc_ver_t *ver1, const pc_ver_t *ver2)
+{
+    int ret;
+
+    ret = cmp_part (&ver1->epoch, &ver2->epoch);
+    if (ret == 0)
+        ret = cmp_part (&ver1->pkgver, &ver2->pkgver);
+    return ret;
+}
+
+void
+pc_ver_free (pc_ver_t *ver)
+{
+    g_free (ver->segs);
+    ver->segs = NULL;
+}
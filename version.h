@@ -0,0 +1,61 @@
+/**
+ * PkgClip - Copyright (C) 2012-2016 Olivier Brunel
+ *
+ * version.h
+ * Copyright (C) 2012-2016 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of PkgClip.
+ *
+ * PkgClip is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PkgClip is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * PkgClip. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef _PKGCLIP_VERSION_H
+#define _PKGCLIP_VERSION_H
+
+/* a segment is a run of digits or letters, as compared by libalpm */
+typedef struct _pc_ver_seg_t {
+    /* points into the version string; leading zeros skipped for numbers */
+    const char  *str;
+    guint        len;
+    /* number of separators (non-alnum chars) before it */
+    guint        sep;
+    gboolean     is_num;
+} pc_ver_seg_t;
+
+typedef struct _pc_ver_part_t {
+    pc_ver_seg_t *segs;
+    guint         nb_segs;
+    /* number of separators after the last segment */
+    guint         trail;
+} pc_ver_part_t;
+
+/* [epoch:]pkgver[-pkgrel] parsed once, so comparisons don't need to parse or
+ * allocate anything */
+typedef struct _pc_ver_t {
+    pc_ver_part_t epoch;
+    pc_ver_part_t pkgver;
+    pc_ver_part_t pkgrel;
+    gboolean      has_pkgrel;
+    /* all segments, in one allocation */
+    pc_ver_seg_t *segs;
+} pc_ver_t;
+
+gsize pc_ver_segs_size (const char *version);
+void pc_ver_parse (pc_ver_t *ver, const char *version);
+void pc_ver_parse_into (pc_ver_t *ver, const char *version, pc_ver_seg_t *segs);
+int pc_ver_cmp (const pc_ver_t *ver1, const pc_ver_t *ver2);
+int pc_ver_cmp_pkgver (const pc_ver_t *ver1, const pc_ver_t *ver2);
+void pc_ver_free (pc_ver_t *ver);
+
+#endif /* _PKGCLIP_VERSION_H */